@@ -0,0 +1,67 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "atomicfile.h"
+
+using namespace std;
+
+bool writeAll(int fd, const char *data, size_t size)
+{
+    while (size)
+    {
+        ssize_t sts = ::write(fd, data, size);
+        if (sts < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += sts;
+        size -= size_t(sts);
+    }
+    return true;
+}
+
+AtomicFile::AtomicFile(const string &path)
+    : m_path(path),
+      m_tmpPath(path + ".tmp")
+{
+}
+
+const string &AtomicFile::path() const
+{
+    return m_path;
+}
+
+int AtomicFile::open() const
+{
+    return ::open(m_tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+bool AtomicFile::commit(int fd, bool ok) const
+{
+    int err = errno;
+    if (ok && ::fsync(fd) != 0)
+    {
+        ok  = false;
+        err = errno;
+    }
+
+    if (::close(fd) != 0 && ok)
+    {
+        ok  = false;
+        err = errno;
+    }
+
+    if (ok && ::rename(m_tmpPath.c_str(), m_path.c_str()) == 0)
+        return true;
+
+    if (ok)
+        err = errno;
+
+    ::unlink(m_tmpPath.c_str());
+    errno = err;
+    return false;
+}
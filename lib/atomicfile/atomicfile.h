@@ -0,0 +1,57 @@
+#ifndef ATOMICFILE_H
+#define ATOMICFILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief writeAll
+ * Write whole buffer, retry on short writes and EINTR.
+ *
+ * @return true on success, false on error (errno will be set)
+ */
+bool writeAll(int fd, const char *data, size_t size);
+
+/**
+ * @brief The AtomicFile class
+ * Replaces file content atomically: data written to the temporary file `path.tmp` that synced to
+ * disk and renamed to `path`. So readers never see partially written file, and after crash there
+ * is either old or new complete file. On error temporary file removed.
+ *
+ * Both names built at construction, so writing does not allocate memory.
+ */
+class AtomicFile
+{
+public:
+    AtomicFile() = default;
+    explicit AtomicFile(const std::string &path);
+
+    const std::string& path() const;
+
+    /**
+     * @brief write
+     * Replace file with the content produced by `writer`.
+     *
+     * @param writer  callable `bool(int fd)`: writes content to the descriptor, returns false on
+     *                error (errno must be set)
+     * @return true on success, false on error (errno will be set)
+     */
+    template<typename Writer>
+    bool write(Writer writer) const
+    {
+        int fd = open();
+        if (fd < 0)
+            return false;
+        return commit(fd, writer(fd));
+    }
+
+private:
+    int  open() const;
+    bool commit(int fd, bool ok) const;
+
+private:
+    std::string m_path;
+    std::string m_tmpPath;
+};
+
+#endif // ATOMICFILE_H
@@ -0,0 +1,103 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "flightrecorder.h"
+#include "atomicfile/atomicfile.h"
+
+using namespace std;
+
+FlightRecorder::FlightRecorder(size_t capacity)
+    : m_buffer(capacity)
+{
+}
+
+void FlightRecorder::append(const char *data, size_t size)
+{
+    const size_t cap = m_buffer.size();
+    if (cap == 0 || size == 0)
+        return;
+
+    // Only tail of the data can be kept
+    if (size > cap)
+    {
+        data += size - cap;
+        size  = cap;
+    }
+
+    const size_t first = std::min(size, cap - m_head);
+    ::memcpy(m_buffer.data() + m_head, data, first);
+    ::memcpy(m_buffer.data(), data + first, size - first);
+
+    m_head = (m_head + size) % cap;
+    m_size = std::min(m_size + size, cap);
+}
+
+void FlightRecorder::clear()
+{
+    m_head = 0;
+    m_size = 0;
+}
+
+size_t FlightRecorder::size() const
+{
+    return m_size;
+}
+
+size_t FlightRecorder::capacity() const
+{
+    return m_buffer.size();
+}
+
+bool FlightRecorder::dump(const AtomicFile &file, pid_t pid, int status, const struct rusage &usage) const
+{
+    char header[512];
+    int  len = ::snprintf(header, sizeof(header),
+                          "pid: %d\n"
+                          "status: %d\n"
+                          "signaled: %s\n"
+                          "signal: %d\n"
+                          "coredump: %s\n"
+                          "exited: %s\n"
+                          "exit_status: %d\n"
+                          "utime: %ld.%06ld\n"
+                          "stime: %ld.%06ld\n"
+                          "maxrss_kb: %ld\n"
+                          "minflt: %ld\n"
+                          "majflt: %ld\n"
+                          "nvcsw: %ld\n"
+                          "nivcsw: %ld\n"
+                          "output_bytes: %zu\n"
+                          "---\n",
+                          int(pid),
+                          status,
+                          WIFSIGNALED(status) ? "true" : "false",
+                          WIFSIGNALED(status) ? WTERMSIG(status) : 0,
+                          WIFSIGNALED(status) && WCOREDUMP(status) ? "true" : "false",
+                          WIFEXITED(status) ? "true" : "false",
+                          WIFEXITED(status) ? WEXITSTATUS(status) : 0,
+                          long(usage.ru_utime.tv_sec), long(usage.ru_utime.tv_usec),
+                          long(usage.ru_stime.tv_sec), long(usage.ru_stime.tv_usec),
+                          usage.ru_maxrss,
+                          usage.ru_minflt,
+                          usage.ru_majflt,
+                          usage.ru_nvcsw,
+                          usage.ru_nivcsw,
+                          m_size);
+    if (len < 0)
+        return false;
+
+    // Oldest data starts just after the head when buffer wrapped
+    const size_t tail  = (m_head + m_buffer.size() - m_size) % std::max<size_t>(m_buffer.size(), 1);
+    const size_t first = std::min(m_size, m_buffer.size() - tail);
+
+    return file.write([&](int fd) {
+        return writeAll(fd, header, std::min(size_t(len), sizeof(header) - 1)) &&
+               writeAll(fd, m_buffer.data() + tail, first) &&
+               writeAll(fd, m_buffer.data(), m_size - first);
+    });
+}
@@ -0,0 +1,63 @@
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <sys/types.h>
+#include <sys/resource.h>
+
+#include <string>
+#include <vector>
+
+class AtomicFile;
+
+/**
+ * @brief The FlightRecorder class
+ * Fixed-size in-memory ring buffer that keeps last bytes of the child output.
+ *
+ * Storage allocated once at construction, so appending never allocates memory and never touches
+ * disk. When child terminates abnormally buffer content can be dumped to the crash file together
+ * with exit status and resource usage of the child.
+ */
+class FlightRecorder
+{
+public:
+    explicit FlightRecorder(size_t capacity);
+
+    /**
+     * @brief append
+     * Put data to the buffer. When buffer is full, oldest data overwrites.
+     *
+     * @param data  data to store
+     * @param size  size of data in bytes
+     */
+    void append(const char *data, size_t size);
+
+    /**
+     * @brief clear
+     * Drop all buffered data. Capacity is not changed.
+     */
+    void clear();
+
+    size_t size() const;
+    size_t capacity() const;
+
+    /**
+     * @brief dump
+     * Write crash report: child exit status, resource usage and buffered output.
+     *
+     * File replaced atomically (see AtomicFile), so readers never see partially written report.
+     *
+     * @param file    crash file
+     * @param pid     child process id
+     * @param status  child exit status as returned by wait()
+     * @param usage   child resource usage
+     * @return true on success, false on error (errno will be set)
+     */
+    bool dump(const AtomicFile &file, pid_t pid, int status, const struct rusage &usage) const;
+
+private:
+    std::vector<char> m_buffer;
+    size_t            m_head = 0; // position for next write
+    size_t            m_size = 0; // count of valid bytes
+};
+
+#endif // FLIGHTRECORDER_H
@@ -1,21 +1,142 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
-#include <iostream>
-#include <sstream>
-#include <iomanip>
+#include <algorithm>
+#include <atomic>
 #include <functional>
-#include <thread>
 #include <exception>
 #include <cassert>
+#include <cerrno>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
 #include "processsupervisor.h"
+#include "flightrecorder.h"
+#include "atomicfile/atomicfile.h"
+#include "statustable/statustable.h"
+#include "tracer/tracer.h"
 #include "safefork.h"
+#include "zygote.h"
+
+namespace {
+
+// Time for the child to exit after SIGABRT before SIGKILL when watchdog timeout is not set
+const int64_t WatchdogAbortGraceUsec = 5000000;
+
+inline int pidfdOpen(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return int(::syscall(SYS_pidfd_open, pid, 0));
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+inline void errorExit(const char *str)
+{
+    perror(str);
+    exit(1);
+}
+
+/**
+ * Environment variable changed for the scope, previous value restored on exit.
+ *
+ * Entries are put with putenv() without copying: `entry` ("NAME=value") must outlive the scope,
+ * previous entry is kept by pointer (putenv() and unsetenv() never free replaced entries).
+ */
+class ScopedEnv
+{
+public:
+    ScopedEnv(bool enabled, const char *name, char *entry)
+        : m_name(enabled ? name : nullptr)
+    {
+        if (!m_name)
+            return;
+
+        const size_t len = ::strlen(name);
+        for (char **env = environ; env && *env; ++env)
+        {
+            if (::strncmp(*env, name, len) == 0 && (*env)[len] == '=')
+            {
+                m_saved = *env;
+                break;
+            }
+        }
+
+        if (entry)
+            ::putenv(entry);
+        else
+            ::unsetenv(name);
+    }
+
+    ~ScopedEnv()
+    {
+        if (!m_name)
+            return;
+
+        if (m_saved)
+            ::putenv(m_saved);
+        else
+            ::unsetenv(m_name);
+    }
+
+    ScopedEnv(const ScopedEnv&) = delete;
+    ScopedEnv& operator=(const ScopedEnv&) = delete;
+
+private:
+    const char *m_name;
+    char       *m_saved = nullptr;
+};
+
+}
+
+ProcessSupervisor::ProcessSupervisor()
+    : m_status(new SupervisorStatus)
+{
+    // Log lines are formatted into preallocated string: no allocations in the supervision loop
+    m_logLine.reserve(LogLineSize);
+}
 
 ProcessSupervisor::ProcessSupervisor(ProcessSupervisor::Routine childRoutine)
-    : m_child(childRoutine)
-{}
+    : ProcessSupervisor()
+{
+    m_child = childRoutine;
+}
+
+ProcessSupervisor::~ProcessSupervisor()
+{
+    m_zygote.reset();
+    unwatchZygote();
+    unwatchChild();
+    closeChildOutput();
+    closeOutput();
+
+    if (m_tick >= 0)
+        ::close(m_tick);
+    if (m_notify >= 0)
+        ::close(m_notify);
+    if (m_watchdog >= 0)
+        ::close(m_watchdog);
+    if (m_epoll >= 0)
+        ::close(m_epoll);
+}
 
 void ProcessSupervisor::setPreforkCallback(ProcessSupervisor::PreforkCallback cb)
 {
@@ -42,6 +163,11 @@ void ProcessSupervisor::setForkRoutine(ProcessSupervisor::ForkRoutine cb)
     m_fork = cb;
 }
 
+void ProcessSupervisor::setOutputForkRoutine(ProcessSupervisor::OutputForkRoutine cb)
+{
+    m_outputFork = cb;
+}
+
 void ProcessSupervisor::setLogCallback(ProcessSupervisor::LogCallback cb)
 {
     m_log = cb;
@@ -52,61 +178,520 @@ void ProcessSupervisor::setChildSignal(int signo)
     m_childSignal = signo;
 }
 
+void ProcessSupervisor::setFlightRecorder(const std::string &crashFile, size_t capacity)
+{
+    if (crashFile.empty())
+    {
+        m_recorder.reset();
+        m_crashFile.reset();
+    }
+    else
+    {
+        m_recorder.reset(new FlightRecorder(capacity));
+        m_crashFile.reset(new AtomicFile(crashFile));
+    }
+}
+
+void ProcessSupervisor::setCrashCheckCallback(ProcessSupervisor::CrashCheckCallback cb)
+{
+    m_crashCheck = cb;
+}
+
+void ProcessSupervisor::setNotifyEnabled(bool enabled)
+{
+    m_notifyEnabled = enabled;
+}
+
+void ProcessSupervisor::setWatchdogTimeout(int64_t usec)
+{
+    m_watchdogTimeout = usec;
+}
+
+void ProcessSupervisor::setReadyCallback(ProcessSupervisor::ReadyCallback cb)
+{
+    m_readyCallback = cb;
+}
+
+void ProcessSupervisor::setStatusFile(const std::string &path)
+{
+    m_statusFile = path;
+    if (path.empty())
+        m_statusPublisher.reset();
+    else
+        m_statusPublisher.reset(new StatusPublisher);
+}
+
+void ProcessSupervisor::setTracer(Tracer *tracer)
+{
+    m_tracer = tracer;
+}
+
 void ProcessSupervisor::setChildRoutine(ProcessSupervisor::Routine cb)
 {
     m_child = cb;
+    m_zygote.reset();
+    unwatchZygote();
+}
+
+void ProcessSupervisor::setZygoteInit(ProcessSupervisor::ZygoteInit init)
+{
+    m_zygoteInit = init;
+    m_zygote.reset();
+    unwatchZygote();
 }
 
 int ProcessSupervisor::start()
 {
-    int  status  = 0;
-    bool restart = true;
-    while (restart)
+    launch();
+
+    while (!finished())
+    {
+        struct pollfd pfd = {pollFd(), POLLIN, 0};
+        if (::poll(&pfd, 1, -1) < 0 && errno != EINTR)
+            errorExit("can't wait for child events");
+
+        processEvents();
+    }
+
+    return exitStatus();
+}
+
+void ProcessSupervisor::launch()
+{
+    if (m_epoll < 0)
     {
-        if (m_prefork)
-            m_prefork();
+        m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll < 0)
+            errorExit("can't create epoll instance");
+    }
+
+    if (running())
+        return;
+
+    if (m_notifyEnabled && m_notify < 0)
+        openNotify();
 
-        pid_t pid;
-        if (m_fork)
-            pid = m_fork();
+    if (m_statusPublisher && !m_statusPublisher->isOpen())
+    {
+        if (m_statusPublisher->open(m_statusFile))
+            m_status->supervisorPid = ::getpid();
         else
-            pid = defaultForkRoutine();
+            log("can't open status file %s: %s", m_statusFile.c_str(), strerror(errno));
+    }
+
+    m_finished   = false;
+    m_exitStatus = 0;
+    spawn();
+}
+
+int ProcessSupervisor::pollFd() const
+{
+    return m_epoll;
+}
+
+void ProcessSupervisor::processEvents()
+{
+    // Drain notifications even without child: stale messages must not keep pollFd() readable
+    receiveNotify();
+
+    if (m_zygote && m_zygote->reap())
+    {
+        log("zygote died: pid=%d", int(m_zygotePid));
+        unwatchZygote();
+    }
+
+    if (!running())
+        return;
+
+    if (m_watchdog >= 0)
+    {
+        uint64_t expirations = 0;
+        if (::read(m_watchdog, &expirations, sizeof(expirations)) > 0 && expirations)
+            fireWatchdog("watchdog timeout");
+    }
+
+    // Level-triggered epoll: consume ticks only, all sources checked below
+    if (m_tick >= 0)
+    {
+        uint64_t expirations;
+        while (::read(m_tick, &expirations, sizeof(expirations)) > 0)
+            ;
+    }
+
+    if (m_recorder)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            if (m_outputPipe[i] >= 0 && !drainOutput(m_outputPipe[i], STDOUT_FILENO + i))
+                closeOutput(i);
+        }
+    }
+
+    int           status;
+    struct rusage usage;
+    pid_t child = wait4(m_pid, &status, WNOHANG, &usage);
+    if (child == 0)
+        return;
+
+    if (child < 0)
+    {
+        // Somebody else reaped our child: exit status lost
+        status = 0;
+        usage  = {};
+    }
+
+    childExited(status, usage);
+}
+
+bool ProcessSupervisor::ready() const
+{
+    return m_ready;
+}
+
+bool ProcessSupervisor::watchdogFired() const
+{
+    return m_watchdogFired;
+}
+
+const std::string &ProcessSupervisor::statusText() const
+{
+    return m_statusText;
+}
+
+const ProcessSupervisor::ReadyHistogram &ProcessSupervisor::readyHistogram() const
+{
+    return m_readyHistogram;
+}
 
-        if (m_postfork)
-            m_postfork(pid);
+bool ProcessSupervisor::running() const
+{
+    return m_pid > 0;
+}
+
+bool ProcessSupervisor::finished() const
+{
+    return m_finished;
+}
+
+int ProcessSupervisor::exitStatus() const
+{
+    return m_exitStatus;
+}
+
+pid_t ProcessSupervisor::childPid() const
+{
+    return m_pid;
+}
+
+void ProcessSupervisor::spawn()
+{
+    Tracer::Span span(m_tracer, "spawn", "supervisor");
+    m_spawnTime = Tracer::now();
+    m_ready     = false;
+    m_watchdogFired = false;
+    m_statusText.clear();
 
-        while (true)
+    if (m_prefork)
+    {
+        Tracer::Span span(m_tracer, "prefork", "supervisor");
+        m_prefork();
+    }
+
+    const bool zygote = !m_outputFork && !m_fork && m_zygoteInit;
+    if (zygote)
+        prepareZygote();
+
+    if (m_recorder)
+        openOutput();
+
+    pid_t pid;
+    {
+        Tracer::Span span(m_tracer, "fork", "supervisor");
+        if (m_outputFork || m_fork)
         {
-            pid_t child = wait(&status);
+            pid = customForkRoutine();
+        }
+        else if (zygote)
+        {
+            pid = zygoteForkRoutine();
+        }
+        else
+        {
+            pid = defaultForkRoutine();
+        }
+    }
+
+    closeChildOutput();
+
+    if (pid <= 0)
+    {
+        log("can't spawn child");
+        m_finished   = true;
+        m_exitStatus = 1;
+        publishStatus(SupervisorState::Finished);
+        return;
+    }
+
+    m_pid = pid;
+    watchChild();
+    armWatchdog(m_watchdogTimeout);
 
-            if (m_log)
+    struct timespec now;
+    ::clock_gettime(CLOCK_REALTIME, &now);
+    m_status->childPid  = pid;
+    m_status->startTime = int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+    publishStatus(SupervisorState::Running);
+    SUPERVISE_PROBE1(spawn, pid);
+
+    if (m_postfork)
+    {
+        Tracer::Span span(m_tracer, "postfork", "supervisor", "pid", pid);
+        m_postfork(pid);
+    }
+}
+
+void ProcessSupervisor::childExited(int status, const struct rusage &usage)
+{
+    const pid_t pid = m_pid;
+
+    // Messages sent just before exit, while sender still matches the child pid
+    receiveNotify();
+    m_ready = false;
+
+    unwatchChild();
+    SUPERVISE_PROBE2(exit, pid, status);
+
+    m_status->childPid       = 0;
+    m_status->lastExitStatus = status;
+    if (m_watchdog >= 0)
+    {
+        struct itimerspec disarm = {};
+        ::timerfd_settime(m_watchdog, 0, &disarm, nullptr);
+    }
+
+    if (m_tracer)
+        m_tracer->complete("child", "child", m_spawnTime, Tracer::now(), "pid", pid, pid);
+
+    {
+        Tracer::Span span(m_tracer, "reap", "supervisor", "status", status);
+
+        if (m_recorder)
+        {
+            // Catch output written just before exit
+            for (int i = 0; i < 2; ++i)
             {
-                std::stringstream ss;
-                ss << std::boolalpha
-                   << "child exits: st=" << status
-                   << ", signaled=" << bool(WIFSIGNALED(status))
-                   << ", signal="   << WTERMSIG(status)
-                   << ", exited="   << bool(WIFEXITED(status))
-                   << ", status="   << WEXITSTATUS(status);
-                m_log(ss.str());
+                if (m_outputPipe[i] >= 0 && !drainOutput(m_outputPipe[i], STDOUT_FILENO + i))
+                    closeOutput(i);
             }
+        }
 
-            if (child == pid)
-            {
-                restart = WIFSIGNALED(status);
-                if (m_restartCheck)
-                    restart = m_restartCheck(status);
-                status  = WIFEXITED(status) ? WEXITSTATUS(status) : 0;
+        log("child exits: st=%d, signaled=%s, signal=%d, exited=%s, status=%d",
+            status,
+            WIFSIGNALED(status) ? "true" : "false",
+            WTERMSIG(status),
+            WIFEXITED(status) ? "true" : "false",
+            WEXITSTATUS(status));
 
-                if (restart && m_prerestart)
-                    m_prerestart();
+        if (m_recorder)
+        {
+            const bool abnormal = m_crashCheck ? m_crashCheck(status)
+                                               : m_watchdogFired || WIFSIGNALED(status) ||
+                                                 (WIFEXITED(status) && WEXITSTATUS(status) != 0);
+            if (abnormal && !m_recorder->dump(*m_crashFile, pid, status, usage))
+                log("can't write crash file %s: %s", m_crashFile->path().c_str(), strerror(errno));
+            m_recorder->clear();
+        }
+    }
 
-                break;
+    bool restart = m_watchdogFired || WIFSIGNALED(status);
+    if (m_restartCheck)
+    {
+        Tracer::Span span(m_tracer, "restart_check", "supervisor", "status", status);
+        restart = m_restartCheck(status);
+    }
+    m_exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : 0;
+    SUPERVISE_PROBE1(restart, int(restart));
+
+    if (restart)
+    {
+        ++m_status->restartCount;
+        publishStatus(SupervisorState::Restarting);
+
+        if (m_prerestart)
+        {
+            Tracer::Span span(m_tracer, "prerestart", "supervisor");
+            m_prerestart();
+        }
+        spawn();
+    }
+    else
+    {
+        closeOutput();
+        m_finished = true;
+        publishStatus(SupervisorState::Finished);
+    }
+}
+
+void ProcessSupervisor::watchChild()
+{
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+
+    // pidfd becomes readable when child terminates. Without it fallback to periodic checks.
+    m_pidfd = pidfdOpen(m_pid);
+    if (m_pidfd >= 0)
+    {
+        ev.data.fd = m_pidfd;
+        ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_pidfd, &ev);
+    }
+    else
+    {
+        if (m_tick < 0)
+        {
+            m_tick = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (m_tick >= 0)
+            {
+                ev.data.fd = m_tick;
+                ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_tick, &ev);
             }
         }
+
+        if (m_tick >= 0)
+        {
+            struct itimerspec period = {{0, 100 * 1000 * 1000}, {0, 100 * 1000 * 1000}};
+            ::timerfd_settime(m_tick, 0, &period, nullptr);
+        }
+    }
+
+    for (int fd : m_outputPipe)
+    {
+        if (fd >= 0)
+        {
+            ev.data.fd = fd;
+            ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev);
+        }
+    }
+}
+
+void ProcessSupervisor::unwatchChild()
+{
+    if (m_pidfd >= 0)
+    {
+        ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, m_pidfd, nullptr);
+        ::close(m_pidfd);
+        m_pidfd = -1;
+    }
+
+    // Disarming also drops pending expirations: pollFd() must not stay readable without child
+    if (m_tick >= 0)
+    {
+        struct itimerspec disarm = {};
+        ::timerfd_settime(m_tick, 0, &disarm, nullptr);
+    }
+    m_pid = 0;
+}
+
+void ProcessSupervisor::prepareZygote()
+{
+    if (!m_child)
+        throw BadChildRoutine("Undefined child rotuine");
+
+    if (!m_zygote)
+    {
+        // Routine runs in the worker: it is a copy of the supervisor made by the zygote fork
+        auto routine = [this]() {
+            exportNotify();
+            return m_child();
+        };
+        m_zygote.reset(new Zygote(m_zygoteInit, routine, [this]() { closeInChild(); }, m_childSignal));
+    }
+
+    if (!m_zygote->start())
+        log("can't start zygote: %s", strerror(errno));
+}
+
+pid_t ProcessSupervisor::zygoteForkRoutine()
+{
+    pid_t pid = m_zygote->spawn(m_childOutput[0] >= 0 ? m_childOutput[0] : STDOUT_FILENO,
+                                m_childOutput[1] >= 0 ? m_childOutput[1] : STDERR_FILENO);
+    if (pid < 0)
+        log("can't spawn child from zygote: %s", strerror(errno));
+
+    // Zygote may be restarted by spawn
+    watchZygote();
+    return pid;
+}
+
+void ProcessSupervisor::watchZygote()
+{
+    const pid_t pid = m_zygote->pid();
+    if (pid == m_zygotePid)
+        return;
+
+    unwatchZygote();
+    if (pid <= 0)
+        return;
+
+    // Without pidfd died zygote reaped on the child events only
+    m_zygotePid   = pid;
+    m_zygotePidfd = pidfdOpen(pid);
+    if (m_zygotePidfd >= 0)
+    {
+        struct epoll_event ev = {};
+        ev.events  = EPOLLIN;
+        ev.data.fd = m_zygotePidfd;
+        ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_zygotePidfd, &ev);
     }
+}
 
-    return status;
+void ProcessSupervisor::unwatchZygote()
+{
+    if (m_zygotePidfd >= 0)
+    {
+        // Descriptor can be shared with a child, so remove it from the epoll set explicitly
+        ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, m_zygotePidfd, nullptr);
+        ::close(m_zygotePidfd);
+        m_zygotePidfd = -1;
+    }
+    m_zygotePid = 0;
+}
+
+pid_t ProcessSupervisor::customForkRoutine()
+{
+    // Every instance has own socket, so variables are exported only while routine forks:
+    // other supervisors and other children of the process must not inherit them
+    ScopedEnv notifySocket(m_notify >= 0, "NOTIFY_SOCKET", &m_notifyEnv[0]);
+    ScopedEnv watchdogUsec(m_notify >= 0, "WATCHDOG_USEC",
+                           m_watchdogEnv.empty() ? nullptr : &m_watchdogEnv[0]);
+    // Child pid is not known yet: drop inherited value, child accepts watchdog without it
+    ScopedEnv watchdogPid(m_notify >= 0, "WATCHDOG_PID", nullptr);
+
+    if (m_outputFork)
+    {
+        return m_outputFork(m_childOutput[0] >= 0 ? m_childOutput[0] : STDOUT_FILENO,
+                            m_childOutput[1] >= 0 ? m_childOutput[1] : STDERR_FILENO);
+    }
+
+    // Plain routine knows nothing about the recorder: child inherits supervisor output
+    redirectOutput();
+    pid_t pid = m_fork();
+    restoreOutput();
+    return pid;
+}
+
+void ProcessSupervisor::closeInChild()
+{
+    // Supervisor descriptors are not needed in the child. Status file closed too: it keeps lock
+    // that must be dropped when supervisor dies.
+    if (m_statusPublisher)
+        m_statusPublisher->close();
+
+    for (int fd : {m_outputPipe[0], m_outputPipe[1], m_childOutput[0], m_childOutput[1],
+                   m_epoll, m_pidfd, m_zygotePidfd, m_tick, m_notify, m_watchdog})
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
 }
 
 pid_t ProcessSupervisor::defaultForkRoutine()
@@ -116,13 +701,16 @@ pid_t ProcessSupervisor::defaultForkRoutine()
     {
         case -1:
         {
-            std::cerr << "Can't fork process\n";
-            exit(1);
+            errorExit("can't fork process");
             break;
         }
 
         case 0: // child
         {
+            attachOutput();
+            exportNotify();
+            closeInChild();
+
             // set signal that will be sent to the child when parent died.
 #ifdef __linux
             prctl(PR_SET_PDEATHSIG, m_childSignal);
@@ -142,3 +730,374 @@ pid_t ProcessSupervisor::defaultForkRoutine()
 
     return pid;
 }
+
+void ProcessSupervisor::openNotify()
+{
+    static std::atomic<unsigned> s_instance(0);
+
+    m_notify = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_notify < 0)
+    {
+        log("can't create notify socket: %s", strerror(errno));
+        return;
+    }
+
+    // Sender credentials are needed to accept messages from the child only
+    int on = 1;
+    ::setsockopt(m_notify, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on));
+
+    // Abstract socket: nothing to clean up in the filesystem
+    char name[64];
+    int  len = ::snprintf(name, sizeof(name), "supervise/%d/%u", int(::getpid()), s_instance++);
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    ::memcpy(addr.sun_path + 1, name, size_t(len));
+
+    if (::bind(m_notify, reinterpret_cast<struct sockaddr*>(&addr),
+               socklen_t(offsetof(struct sockaddr_un, sun_path) + 1 + len)) < 0)
+    {
+        log("can't bind notify socket: %s", strerror(errno));
+        ::close(m_notify);
+        m_notify = -1;
+        return;
+    }
+
+    m_notifyPath = std::string("@") + name;
+    m_notifyEnv  = "NOTIFY_SOCKET=" + m_notifyPath;
+
+    struct epoll_event ev = {};
+    ev.events  = EPOLLIN;
+    ev.data.fd = m_notify;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_notify, &ev);
+
+    if (m_watchdogTimeout > 0)
+        m_watchdogEnv = "WATCHDOG_USEC=" + std::to_string(m_watchdogTimeout);
+
+    // Also times the SIGABRT grace period after `WATCHDOG=trigger` without watchdog timeout
+    m_watchdog = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_watchdog >= 0)
+    {
+        ev.data.fd = m_watchdog;
+        ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_watchdog, &ev);
+    }
+}
+
+void ProcessSupervisor::exportNotify()
+{
+    // Called in the child only
+    if (m_notify < 0)
+        return;
+
+    ::setenv("NOTIFY_SOCKET", m_notifyPath.c_str(), 1);
+    if (m_watchdogTimeout > 0)
+    {
+        char usec[32];
+        ::snprintf(usec, sizeof(usec), "%lld", (long long)m_watchdogTimeout);
+        ::setenv("WATCHDOG_USEC", usec, 1);
+
+        // Inherited WATCHDOG_PID (supervisor under systemd) would disable sd_watchdog_enabled()
+        char pid[16];
+        ::snprintf(pid, sizeof(pid), "%d", int(::getpid()));
+        ::setenv("WATCHDOG_PID", pid, 1);
+    }
+    else
+    {
+        ::unsetenv("WATCHDOG_USEC");
+        ::unsetenv("WATCHDOG_PID");
+    }
+}
+
+void ProcessSupervisor::receiveNotify()
+{
+    if (m_notify < 0)
+        return;
+
+    for (;;)
+    {
+        char buf[4096];
+        union
+        {
+            struct cmsghdr align;
+            char           data[CMSG_SPACE(sizeof(struct ucred))];
+        } control;
+
+        struct iovec  iov = {buf, sizeof(buf) - 1};
+        struct msghdr msg = {};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control.data;
+        msg.msg_controllen = sizeof(control.data);
+
+        ssize_t len = ::recvmsg(m_notify, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+
+        pid_t sender = 0;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_CREDENTIALS)
+            {
+                struct ucred cred;
+                ::memcpy(&cred, CMSG_DATA(cmsg), sizeof(cred));
+                sender = cred.pid;
+            }
+            else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            {
+                // FDSTORE is not supported: close passed descriptors
+                const int *fds = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+                size_t     n   = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for (size_t i = 0; i < n; ++i)
+                    ::close(fds[i]);
+            }
+        }
+
+        if (sender == 0 || sender != m_pid)
+        {
+            log("notify message from pid=%d ignored", int(sender));
+            continue;
+        }
+
+        handleNotify(buf, size_t(len));
+    }
+}
+
+void ProcessSupervisor::handleNotify(const char *msg, size_t size)
+{
+    const char *end = msg + size;
+    while (msg < end)
+    {
+        const char *eol = static_cast<const char*>(::memchr(msg, '\n', size_t(end - msg)));
+        if (!eol)
+            eol = end;
+
+        const size_t len = size_t(eol - msg);
+        auto is = [msg, len](const char *key, size_t keyLen) {
+            return len >= keyLen && ::memcmp(msg, key, keyLen) == 0;
+        };
+
+        if (len == 7 && is("READY=1", 7))
+        {
+            if (!m_ready)
+            {
+                m_ready = true;
+
+                const int64_t now     = Tracer::now();
+                const int64_t latency = (now - m_spawnTime) / 1000;
+
+                size_t bucket = 0;
+                while (bucket + 1 < m_readyHistogram.size() && (int64_t(2) << bucket) <= latency)
+                    ++bucket;
+                ++m_readyHistogram[bucket];
+
+                if (m_tracer)
+                    m_tracer->complete("startup", "child", m_spawnTime, now, "pid", m_pid, m_pid);
+                SUPERVISE_PROBE2(ready, m_pid, latency);
+
+                publishStatus(SupervisorState::Ready);
+
+                log("child ready: pid=%d, time=%lld us", int(m_pid), (long long)latency);
+                if (m_readyCallback)
+                    m_readyCallback(m_pid, latency);
+            }
+        }
+        else if (is("STATUS=", 7))
+        {
+            m_statusText.assign(msg + 7, len - 7);
+        }
+        else if (len == 10 && is("WATCHDOG=1", 10))
+        {
+            // Late ping does not cancel SIGKILL escalation
+            if (!m_watchdogFired)
+                armWatchdog(m_watchdogTimeout);
+        }
+        else if (len == 16 && is("WATCHDOG=trigger", 16))
+        {
+            if (!m_watchdogFired)
+                fireWatchdog("watchdog triggered by child");
+        }
+
+        msg = eol + 1;
+    }
+}
+
+void ProcessSupervisor::armWatchdog(int64_t usec)
+{
+    if (m_watchdog < 0 || usec <= 0)
+        return;
+
+    struct itimerspec timeout = {};
+    timeout.it_value.tv_sec  = time_t(usec / 1000000);
+    timeout.it_value.tv_nsec = long(usec % 1000000) * 1000;
+    ::timerfd_settime(m_watchdog, 0, &timeout, nullptr);
+}
+
+void ProcessSupervisor::fireWatchdog(const char *reason)
+{
+    if (m_watchdogFired)
+    {
+        // Child ignores or handles SIGABRT and does not exit in time
+        log("watchdog kill: pid=%d", int(m_pid));
+        ::kill(m_pid, SIGKILL);
+        return;
+    }
+
+    log("%s: pid=%d", reason, int(m_pid));
+    m_watchdogFired = true;
+    ::kill(m_pid, SIGABRT);
+    armWatchdog(m_watchdogTimeout > 0 ? m_watchdogTimeout : WatchdogAbortGraceUsec);
+}
+
+void ProcessSupervisor::publishStatus(SupervisorState state)
+{
+    if (!m_statusPublisher)
+        return;
+
+    m_status->state = state;
+    m_status->ready = m_ready;
+    m_statusPublisher->publish(*m_status);
+}
+
+void ProcessSupervisor::log(const char *fmt, ...)
+{
+    if (!m_log)
+        return;
+
+    char    buf[LogLineSize];
+    va_list args;
+    va_start(args, fmt);
+    int len = ::vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    if (len < 0)
+        return;
+
+    m_logLine.assign(buf, std::min(size_t(len), sizeof(buf) - 1));
+    m_log(m_logLine);
+}
+
+void ProcessSupervisor::openOutput()
+{
+    closeOutput();
+
+    for (int i = 0; i < 2; ++i)
+    {
+        int fds[2];
+        if (::pipe2(fds, O_CLOEXEC) == -1)
+        {
+            log("can't create recorder pipe: %s", strerror(errno));
+            continue;
+        }
+
+        ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+        m_outputPipe[i]  = fds[0];
+        m_childOutput[i] = fds[1];
+    }
+}
+
+void ProcessSupervisor::attachOutput()
+{
+    // Called in the child: supervisor stdout and stderr are never touched
+    for (int i = 0; i < 2; ++i)
+    {
+        const int target = STDOUT_FILENO + i;
+        int      &fd     = m_childOutput[i];
+        if (fd < 0 || fd == target)
+            continue;
+
+        ::dup2(fd, target); // dup2() clears FD_CLOEXEC on the target
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void ProcessSupervisor::closeChildOutput()
+{
+    for (int &fd : m_childOutput)
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+}
+
+void ProcessSupervisor::redirectOutput()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        if (m_childOutput[i] < 0)
+            continue;
+
+        const int target = STDOUT_FILENO + i;
+        m_savedOutput[i] = ::fcntl(target, F_DUPFD_CLOEXEC, 3);
+        ::dup2(m_childOutput[i], target); // dup2() clears FD_CLOEXEC, so child inherits it
+    }
+}
+
+void ProcessSupervisor::restoreOutput()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        if (m_childOutput[i] < 0)
+            continue;
+
+        const int target = STDOUT_FILENO + i;
+        if (m_savedOutput[i] >= 0)
+        {
+            ::dup2(m_savedOutput[i], target);
+            ::close(m_savedOutput[i]);
+            m_savedOutput[i] = -1;
+        }
+        else
+        {
+            ::close(target);
+        }
+    }
+}
+
+void ProcessSupervisor::closeOutput()
+{
+    closeOutput(0);
+    closeOutput(1);
+}
+
+void ProcessSupervisor::closeOutput(int index)
+{
+    int &fd = m_outputPipe[index];
+    if (fd < 0)
+        return;
+
+    // Descriptor can be shared with a child, so remove it from the epoll set explicitly
+    if (m_epoll >= 0)
+        ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    fd = -1;
+}
+
+bool ProcessSupervisor::drainOutput(int fd, int teeFd)
+{
+    char buf[4096];
+    for (;;)
+    {
+        ssize_t sts = ::read(fd, buf, sizeof(buf));
+        if (sts > 0)
+        {
+            m_recorder->append(buf, size_t(sts));
+            writeAll(teeFd, buf, size_t(sts));
+            continue;
+        }
+
+        if (sts < 0 && errno == EINTR)
+            continue;
+
+        // EOF or error: nobody can write here anymore
+        return sts < 0 && errno == EAGAIN;
+    }
+}
@@ -2,9 +2,22 @@
 #define PROCESSSUPERVISOR_H
 
 #include <signal.h>
+#include <sys/resource.h>
 
+#include <array>
+#include <cstdint>
 #include <functional>
 #include <stdexcept>
+#include <memory>
+#include <string>
+
+class AtomicFile;
+class FlightRecorder;
+class StatusPublisher;
+class Tracer;
+class Zygote;
+struct SupervisorStatus;
+enum class SupervisorState : uint32_t;
 
 /**
  * @brief The BadChildRoutine exception class
@@ -27,27 +40,236 @@ public:
     typedef std::function<void()>                   PrerestartCallback;
     typedef std::function<void(const std::string&)> LogCallback;
     typedef std::function<pid_t()>                  ForkRoutine;
+    typedef std::function<pid_t(int, int)>          OutputForkRoutine;
+    typedef std::function<bool(int)>                CrashCheckCallback;
     typedef std::function<int()>                    Routine;
+    typedef std::function<void(pid_t, int64_t)>     ReadyCallback;
+    typedef std::function<void()>                   ZygoteInit;
+
+    /// Time-to-ready histogram: bucket `i` counts starts with latency in [2^i, 2^(i+1)) usec
+    typedef std::array<uint64_t, 32>                ReadyHistogram;
 
-    ProcessSupervisor() = default;
+    ProcessSupervisor();
     explicit ProcessSupervisor(Routine childRoutine);
+    ~ProcessSupervisor();
 
     void setPreforkCallback(PreforkCallback cb);
     void setPostforkCallback(PostforkCallback cb);
     void setRestartCheckCallback(RestartCheckCallback cb);
     void setPrerestartCallback(PrerestartCallback cb);
     void setForkRoutine(ForkRoutine cb);
+
+    /**
+     * @brief setOutputForkRoutine
+     * Fork routine that gets descriptors for the child stdout and stderr. Child must dup2() them
+     * to STDOUT_FILENO and STDERR_FILENO. Descriptors are close-on-exec and closed by supervisor
+     * after routine returns. Without flight recorder they are supervisor stdout and stderr.
+     * Takes precedence over setForkRoutine().
+     */
+    void setOutputForkRoutine(OutputForkRoutine cb);
     void setChildRoutine(Routine cb);
 
+    /**
+     * @brief setZygoteInit
+     * Enable zygote mode for the child routine (ignored when fork routine set).
+     *
+     * Supervisor starts template process that runs `init` once (load configs, map data files,
+     * warm caches) and every restart creates child from this prepared state instead of the fresh
+     * fork, so child routine does not repeat heavy initialization. @see Zygote
+     *
+     * Zygote serves requests after initialization only, so launch() or processEvents() that
+     * spawns first child (or child after zygote death) blocks until `init` completes. Died zygote
+     * reaped by processEvents() and restarted on next spawn.
+     *
+     * @param init  initialization routine, runs in the zygote process. Must not start threads.
+     */
+    void setZygoteInit(ZygoteInit init);
+
     void setLogCallback(LogCallback cb);  
 
     void setChildSignal(int signo);
     int  childSignal() const;
 
+    /**
+     * @brief setFlightRecorder
+     * Keep last `capacity` bytes of the child stdout and stderr in memory.
+     *
+     * Child output passes through supervisor's stdout and stderr as usual. When child terminates
+     * by signal or with non-zero exit status, recorded output dumped atomically to the `crashFile`
+     * together with exit status and resource usage. Empty `crashFile` disables recorder.
+     *
+     * With the plain fork routine (setForkRoutine()) child output can't be passed other way, so
+     * supervisor stdout and stderr are replaced by the recorder pipes while routine runs: output of
+     * other threads written in this window goes to the child record. Use default fork routine,
+     * zygote or setOutputForkRoutine() when other threads write to stdout or stderr.
+     *
+     * @param crashFile  crash report file name
+     * @param capacity   ring buffer size in bytes
+     */
+    void setFlightRecorder(const std::string &crashFile, size_t capacity = 256 * 1024);
+
+    /**
+     * @brief setCrashCheckCallback
+     * Decide whether child exit is a crash and recorded output must be dumped. Gets wait() status.
+     * By default any termination by signal and non-zero exit status are crashes.
+     */
+    void setCrashCheckCallback(CrashCheckCallback cb);
+
+    /**
+     * @name Readiness notification
+     * sd_notify() compatible protocol: supervisor creates datagram socket and passes it to the
+     * child via NOTIFY_SOCKET environment variable. Only messages from the child process itself
+     * are accepted. Supported assignments:
+     * - `READY=1` - child completes startup, time-to-ready is recorded
+     * - `STATUS=...` - free-form status text
+     * - `WATCHDOG=1` - keep-alive ping, `WATCHDOG=trigger` - immediate watchdog failure
+     * @{
+     */
+
+    /**
+     * @brief setNotifyEnabled
+     * Enable readiness notification socket. Must be called before launch().
+     *
+     * NOTIFY_SOCKET, WATCHDOG_USEC and WATCHDOG_PID are set in the child only, supervisor
+     * environment is not changed. Custom fork routines fork from the supervisor process, so for them
+     * variables are set in the process environment while routine runs and restored after it:
+     * setenv() is not thread-safe, so do not read environment from other threads at that time.
+     * WATCHDOG_PID is unset for custom routines since the child pid is not known before fork.
+     */
+    void setNotifyEnabled(bool enabled);
+
+    /**
+     * @brief setWatchdogTimeout
+     * Kill child with SIGABRT if it does not send `WATCHDOG=1` for `usec` microseconds since start
+     * or previous ping. Value passed to the child in WATCHDOG_USEC. Zero disables watchdog.
+     *
+     * Child still running `usec` after SIGABRT (5 s after `WATCHDOG=trigger` without watchdog
+     * timeout) is killed with SIGKILL. See watchdogFired().
+     */
+    void setWatchdogTimeout(int64_t usec);
+
+    /**
+     * @brief setReadyCallback
+     * Called on `READY=1` with child pid and time from spawn to ready in microseconds.
+     */
+    void setReadyCallback(ReadyCallback cb);
+
+    bool                  ready() const;
+
+    /**
+     * @brief watchdogFired
+     * Watchdog expired or triggered for the current (or just exited) child. Crash and restart
+     * checks may use it: child handling SIGABRT can exit with clean status. By default such exit
+     * is a crash and child is restarted.
+     */
+    bool                  watchdogFired() const;
+    const std::string&    statusText() const;
+    const ReadyHistogram& readyHistogram() const;
+    /// @}
+
+    /**
+     * @brief setStatusFile
+     * Publish supervisor state (pids, state, start time, restart count, last exit status, ready
+     * flag) to the memory-mapped status file, that can be read without syscalls with StatusReader.
+     * File opened and locked on launch(): readers detect records of died supervisors.
+     * Empty path disables publishing.
+     */
+    void setStatusFile(const std::string &path);
+
+    /**
+     * @brief setTracer
+     * Record lifecycle spans (prefork, fork, postfork, child lifetime, reap, restart check,
+     * prerestart) to the tracer. Tracer is not owned and must outlive supervisor. Null disables.
+     */
+    void setTracer(Tracer *tracer);
+
+    /**
+     * @brief start
+     * Blocking supervision: runs child and restarts it until restart check allows.
+     *
+     * It is a simple loop over the non-blocking API below.
+     *
+     * @return child exit status or 0 when child terminated by signal
+     */
     int start();
 
+    /**
+     * @name Non-blocking API
+     * Allows to embed supervisor into the application event loop. Many supervisors can be
+     * served by one thread:
+     * @code
+     * sv.launch();
+     * // add sv.pollFd() to the select()/poll()/epoll set for reading
+     * // ...
+     * // when it readable:
+     * sv.processEvents();
+     * if (sv.finished())
+     *     // remove sv.pollFd() from the set, sv.exitStatus() contains child exit status
+     * @endcode
+     *
+     * All callbacks are called from launch() and processEvents(), so heavy callbacks (like sleep
+     * before restart) block the caller. Only own child reaped, so other process children are not
+     * affected.
+     * @{
+     */
+
+    /**
+     * @brief launch
+     * Start child process. Does nothing if child already running.
+     */
+    void launch();
+
+    /**
+     * @brief pollFd
+     * Descriptor that becomes readable when processEvents() has work to do. Valid after launch().
+     */
+    int  pollFd() const;
+
+    /**
+     * @brief processEvents
+     * Handle pending events without blocking: child output, child termination and restart.
+     */
+    void processEvents();
+
+    bool  running() const;
+    bool  finished() const;
+    int   exitStatus() const;
+    pid_t childPid() const;
+    /// @}
+
 private:
+    static constexpr size_t LogLineSize = 256;
+
     pid_t defaultForkRoutine();
+    void  prepareZygote();
+    pid_t zygoteForkRoutine();
+    void  watchZygote();
+    void  unwatchZygote();
+    pid_t customForkRoutine();
+    void  closeInChild();
+
+    void  log(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    void  spawn();
+    void  openNotify();
+    void  exportNotify();
+    void  receiveNotify();
+    void  handleNotify(const char *msg, size_t size);
+    void  armWatchdog(int64_t usec);
+    void  fireWatchdog(const char *reason);
+    void  publishStatus(SupervisorState state);
+    void  childExited(int status, const struct rusage &usage);
+    void  watchChild();
+    void  unwatchChild();
+
+    void  openOutput();
+    void  attachOutput();
+    void  closeChildOutput();
+    void  redirectOutput();
+    void  restoreOutput();
+    void  closeOutput();
+    void  closeOutput(int index);
+    bool  drainOutput(int fd, int teeFd);
 
 private:
     PreforkCallback  m_prefork;
@@ -55,9 +277,49 @@ private:
     RestartCheckCallback m_restartCheck;
     PrerestartCallback m_prerestart;
     LogCallback      m_log;
+    std::string      m_logLine;
     ForkRoutine      m_fork;
+    OutputForkRoutine m_outputFork;
     Routine          m_child;
+    ZygoteInit       m_zygoteInit;
+    std::unique_ptr<Zygote> m_zygote;
+    int              m_zygotePidfd = -1;
+    pid_t            m_zygotePid   = 0; // watched zygote
     int              m_childSignal = SIGTERM;
+
+    Tracer          *m_tracer     = nullptr;
+    int64_t          m_spawnTime  = 0; // monotonic, nanoseconds
+
+    bool             m_notifyEnabled = false;
+    int              m_notify     = -1;
+    std::string      m_notifyPath;
+    std::string      m_notifyEnv;   // "NOTIFY_SOCKET=..." for putenv()
+    std::string      m_watchdogEnv; // "WATCHDOG_USEC=..." for putenv(), empty without watchdog
+    int              m_watchdog   = -1;
+    int64_t          m_watchdogTimeout = 0;
+    bool             m_watchdogFired = false;
+    ReadyCallback    m_readyCallback;
+    bool             m_ready      = false;
+    std::string      m_statusText;
+    ReadyHistogram   m_readyHistogram = {};
+
+    std::string      m_statusFile;
+    std::unique_ptr<StatusPublisher>  m_statusPublisher;
+    std::unique_ptr<SupervisorStatus> m_status;
+
+    std::unique_ptr<FlightRecorder> m_recorder;
+    std::unique_ptr<AtomicFile> m_crashFile;
+    CrashCheckCallback m_crashCheck;
+    int              m_outputPipe[2]  = {-1, -1}; // read ends of the child stdout and stderr
+    int              m_childOutput[2] = {-1, -1}; // write ends, open while forking
+    int              m_savedOutput[2] = {-1, -1}; // supervisor stdout and stderr while forking
+
+    int              m_epoll      = -1;
+    int              m_pidfd      = -1;
+    int              m_tick       = -1; // timer, when pidfd is not supported
+    pid_t            m_pid        = 0;
+    bool             m_finished   = false;
+    int              m_exitStatus = 0;
 };
 
 #endif // PROCESSSUPERVISOR_H
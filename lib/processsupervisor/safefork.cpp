@@ -1,6 +1,9 @@
+#include <fcntl.h>
 #include <unistd.h>
 
-#include <fstream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 
 #include "safefork.h"
 
@@ -9,29 +12,39 @@ using namespace std;
 #ifdef __linux
 ssize_t get_process_threads_count() noexcept
 {
-    string  fileName = "/proc/self/status";
-    ssize_t count    = -1;
+    const char fileName[] = "/proc/self/status";
+    ssize_t    count      = -1;
 
-    ifstream ifs(fileName);
-    if (!ifs)
+    // Plain read() into stack buffer: no streams and no allocations, fork path stays lightweight
+    int fd = ::open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
     {
         //cerr << "Can't open process stat file: " << fileName << endl;
         return -1;
     }
 
-    string line;
-    while (getline(ifs, line))
+    char    buf[4096];
+    ssize_t len = 0;
+    ssize_t sts;
+    while (len < ssize_t(sizeof(buf) - 1) &&
+           (sts = ::read(fd, buf + len, sizeof(buf) - 1 - len)) != 0)
     {
-        constexpr static char subline[] = "Threads:\0";
-
-        size_t pos = line.find(subline);
-
-        if (pos != string::npos)
+        if (sts < 0)
         {
-            count = strtoul(line.c_str() + pos + sizeof(subline) - 1, nullptr, 10);
+            if (errno == EINTR)
+                continue;
             break;
         }
+        len += sts;
     }
+    ::close(fd);
+    buf[len] = '\0';
+
+    constexpr static char subline[] = "\nThreads:";
+
+    const char *pos = ::strstr(buf, subline);
+    if (pos)
+        count = ::strtol(pos + sizeof(subline) - 1, nullptr, 10);
 
     return count;
 }
@@ -0,0 +1,263 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "zygote.h"
+#include "safefork.h"
+
+namespace {
+
+// Spawn request: one command byte and worker stdin, stdout, stderr
+constexpr char   SpawnCommand = 'S';
+constexpr size_t PassedFds    = 3;
+
+union FdControl
+{
+    struct cmsghdr align;
+    char           data[CMSG_SPACE(sizeof(int) * PassedFds)];
+};
+
+}
+
+Zygote::Zygote(Zygote::InitRoutine init, Zygote::Routine routine, Zygote::CleanupRoutine cleanup,
+               int childSignal)
+    : m_init(init),
+      m_routine(routine),
+      m_cleanup(cleanup),
+      m_childSignal(childSignal)
+{
+}
+
+Zygote::~Zygote()
+{
+    stop();
+}
+
+pid_t Zygote::pid() const
+{
+    return m_pid;
+}
+
+pid_t Zygote::spawn(int stdoutFd, int stderrFd)
+{
+    // Second attempt restarts died zygote
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        if (!start())
+            return -1;
+
+        pid_t pid = request(stdoutFd, stderrFd);
+        if (pid > 0 || m_channel >= 0)
+            return pid;
+    }
+    return -1;
+}
+
+bool Zygote::start()
+{
+    if (m_pid > 0)
+        return true;
+
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1)
+        return false;
+
+    pid_t pid = safe_fork();
+    if (pid == -1)
+    {
+        int err = errno;
+        ::close(fds[0]);
+        ::close(fds[1]);
+        errno = err;
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        ::close(fds[0]);
+        serve(fds[1]);
+    }
+
+    ::close(fds[1]);
+    m_channel = fds[0];
+    m_pid     = pid;
+    return true;
+}
+
+bool Zygote::reap()
+{
+    if (m_pid <= 0)
+        return false;
+
+    pid_t pid;
+    while ((pid = ::waitpid(m_pid, nullptr, WNOHANG)) == -1 && errno == EINTR)
+        ;
+    if (pid != m_pid)
+        return false;
+
+    m_pid = 0;
+    stop();
+    return true;
+}
+
+void Zygote::stop()
+{
+    if (m_channel >= 0)
+    {
+        ::close(m_channel);
+        m_channel = -1;
+    }
+
+    if (m_pid > 0)
+    {
+        // Zygote keeps no state worth graceful shutdown
+        ::kill(m_pid, SIGKILL);
+        while (::waitpid(m_pid, nullptr, 0) == -1 && errno == EINTR)
+            ;
+        m_pid = 0;
+    }
+}
+
+pid_t Zygote::request(int stdoutFd, int stderrFd)
+{
+    char      cmd = SpawnCommand;
+    int       fds[PassedFds] = {STDIN_FILENO, stdoutFd, stderrFd};
+    FdControl control;
+
+    struct iovec  iov = {&cmd, sizeof(cmd)};
+    struct msghdr msg = {};
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.data;
+    msg.msg_controllen = sizeof(control.data);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(fds));
+    ::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    int32_t reply = 0;
+    ssize_t sts;
+    while ((sts = ::sendmsg(m_channel, &msg, MSG_NOSIGNAL)) == -1 && errno == EINTR)
+        ;
+    if (sts == 1)
+    {
+        while ((sts = ::recv(m_channel, &reply, sizeof(reply), 0)) == -1 && errno == EINTR)
+            ;
+    }
+
+    if (sts != sizeof(reply))
+    {
+        // Zygote died: drop it, caller restarts
+        int err = sts == -1 ? errno : EPIPE;
+        stop();
+        errno = err;
+        return -1;
+    }
+
+    if (reply < 0)
+    {
+        errno = -reply;
+        return -1;
+    }
+
+    return pid_t(reply);
+}
+
+void Zygote::serve(int channel)
+{
+#ifdef __linux
+    ::prctl(PR_SET_PDEATHSIG, m_childSignal);
+#else
+#  error Unsupported OS
+#endif
+
+    if (m_cleanup)
+        m_cleanup();
+
+    if (m_init)
+        m_init();
+
+    for (;;)
+    {
+        char      cmd;
+        FdControl control;
+
+        struct iovec  iov = {&cmd, sizeof(cmd)};
+        struct msghdr msg = {};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control.data;
+        msg.msg_controllen = sizeof(control.data);
+
+        ssize_t sts = ::recvmsg(channel, &msg, MSG_CMSG_CLOEXEC);
+        if (sts == -1 && errno == EINTR)
+            continue;
+        if (sts <= 0)
+            ::_exit(0); // supervisor closed channel or died
+
+        int    fds[PassedFds] = {-1, -1, -1};
+        size_t count          = 0;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            {
+                count = std::min(PassedFds, (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+                ::memcpy(fds, CMSG_DATA(cmsg), count * sizeof(int));
+            }
+        }
+
+        int32_t reply;
+        if (cmd != SpawnCommand)
+        {
+            reply = -EINVAL;
+        }
+        else if (get_process_threads_count() > 1)
+        {
+            // Same rule as safe_fork(): init routine started threads
+            reply = -EDEADLK;
+        }
+        else
+        {
+            // CLONE_PARENT: worker becomes a child of the supervisor, not the zygote
+            long pid = ::syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0);
+            if (pid == 0)
+            {
+                ::prctl(PR_SET_PDEATHSIG, m_childSignal);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (fds[i] == int(i))
+                        continue;
+                    ::dup2(fds[i], int(i));
+                    ::close(fds[i]);
+                }
+                ::close(channel);
+
+                exit(m_routine());
+            }
+
+            reply = pid < 0 ? -errno : int32_t(pid);
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (fds[i] > STDERR_FILENO)
+                ::close(fds[i]);
+        }
+
+        while (::send(channel, &reply, sizeof(reply), MSG_NOSIGNAL) == -1 && errno == EINTR)
+            ;
+    }
+}
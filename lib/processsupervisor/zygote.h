@@ -0,0 +1,97 @@
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <sys/types.h>
+
+#include <functional>
+
+/**
+ * @brief The Zygote class
+ * Fork server for the fast respawn of in-process child routines.
+ *
+ * Zygote is a template process that runs heavy initialization (loads configs, maps data files,
+ * warms caches) once and then waits for commands on the socket pair. On every spawn request it
+ * creates worker with clone(CLONE_PARENT): worker starts from the already initialized state,
+ * shares unmodified pages with the zygote (copy-on-write) and becomes a direct child of the
+ * supervisor, so it can be reaped with waitpid() as usual.
+ *
+ * Supervisor stdin and given stdout and stderr descriptors passed to the worker with the request,
+ * so output capture (like flight recorder) works with zygote too.
+ *
+ * @note
+ * Zygote must stay single-threaded: init routine must not start threads. Worker created with
+ * raw clone() system call, so glibc fork bookkeeping is skipped in the worker:
+ * - pthread_atfork() handlers are not called;
+ * - thread id cached in the thread descriptor is not updated and stays equal to the zygote pid.
+ *   So pthread_self()-based ownership checks are wrong: mutexes of error-checking and recursive
+ *   types, and robust mutexes, locked in the zygote look owned by the worker (and vice versa for
+ *   shared ones). Init routine must leave no such mutexes locked and worker must not rely on
+ *   them being consistent with the zygote. gettid() system call returns correct value.
+ */
+class Zygote
+{
+public:
+    typedef std::function<void()> InitRoutine;
+    typedef std::function<int()>  Routine;
+    typedef std::function<void()> CleanupRoutine;
+
+    /**
+     * @param init         runs once in the zygote process after fork
+     * @param routine      runs in the worker, its result is the worker exit status
+     * @param cleanup      runs in the zygote process before init: close supervisor descriptors
+     * @param childSignal  signal that zygote and worker get when supervisor dies
+     */
+    Zygote(InitRoutine init, Routine routine, CleanupRoutine cleanup, int childSignal);
+    ~Zygote();
+
+    Zygote(const Zygote&) = delete;
+    Zygote& operator=(const Zygote&) = delete;
+
+    /**
+     * @brief spawn
+     * Create worker process. Zygote started on first call and restarted if it died.
+     *
+     * Blocks until zygote replies. Zygote handles requests after init routine only, so first call
+     * (and call after zygote restart) waits for the whole init routine.
+     *
+     * @param stdoutFd  descriptor that becomes worker stdout
+     * @param stderrFd  descriptor that becomes worker stderr
+     * @return worker pid or -1 on error (errno will be set)
+     */
+    pid_t spawn(int stdoutFd, int stderrFd);
+
+    /**
+     * @brief start
+     * Start zygote process if it is not running. Blocks only for fork(): init routine runs in
+     * the zygote concurrently with the caller, until next spawn() that waits for it.
+     *
+     * @return true on success, false on error (errno will be set)
+     */
+    bool  start();
+
+    pid_t pid() const;
+
+    /**
+     * @brief reap
+     * Reap zygote if it died, so it does not stay zombie until next spawn(). Does not block.
+     *
+     * @return true when died zygote reaped
+     */
+    bool  reap();
+
+private:
+    void  stop();
+    pid_t request(int stdoutFd, int stderrFd);
+
+    [[noreturn]] void serve(int channel);
+
+private:
+    InitRoutine    m_init;
+    Routine        m_routine;
+    CleanupRoutine m_cleanup;
+    int            m_childSignal;
+    pid_t          m_pid     = 0; // zygote process
+    int            m_channel = -1;
+};
+
+#endif // ZYGOTE_H
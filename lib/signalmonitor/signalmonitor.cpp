@@ -1,7 +1,9 @@
-#include <iostream>
+#include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 
 #include "signalmonitor.h"
+#include "tracer/tracer.h"
 
 using namespace std;
 
@@ -76,6 +78,11 @@ void SignalMonitor::setHandler(const SignalMonitor::MessageHandler &handler)
     m_handler = handler;
 }
 
+void SignalMonitor::setTracer(Tracer *tracer)
+{
+    m_tracer = tracer;
+}
+
 int SignalMonitor::sendMessage(int signo)
 {
     uint8_t ch = (uint8_t)signo;
@@ -125,8 +132,10 @@ void SignalMonitor::run()
                         errorExit("unhandler error on signal pipe read");
                 }
 
+                SUPERVISE_PROBE1(signal, int(ch));
                 if (m_handler)
                 {
+                    Tracer::Span span(m_tracer, "signal", "signal", "signo", ch);
                     m_handler(ch);
                 }
             }
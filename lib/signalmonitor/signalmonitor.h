@@ -15,6 +15,8 @@
 #include <signal.h>
 #include <sys/wait.h>
 
+class Tracer;
+
 /**
  * @brief The SignalMonitor struct
  * Self-pipe signal handling implementation.
@@ -119,6 +121,15 @@ public:
      */
     void setHandler(const MessageHandler &handler);
 
+    /**
+     * @brief setTracer
+     * Record signal handling spans to the tracer. Tracer is not owned. Null disables tracing.
+     *
+     * @note
+     * Like setHandler() must be called before any signal handling.
+     */
+    void setTracer(Tracer *tracer);
+
     /**
      * @brief sendMessage
      * Send signal number from signal catcher to monitor.
@@ -226,6 +237,7 @@ private:
 private:
     int                 m_signalPipe[2] = {-1};
     MessageHandler      m_handler;
+    Tracer             *m_tracer = nullptr;
     std::atomic_bool    m_needStop;
     std::thread         m_thread;
 };
@@ -0,0 +1,240 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <cerrno>
+
+#include "statustable.h"
+
+using namespace std;
+
+namespace {
+
+// Reader gives up when writer keeps record locked: probably it died in the middle of update
+constexpr int ReadAttempts = 10000;
+
+inline struct flock wholeFileLock(short type)
+{
+    struct flock lock = {};
+    lock.l_type   = type;
+    lock.l_whence = SEEK_SET;
+    return lock;
+}
+
+}
+
+const char *supervisorStateName(SupervisorState state)
+{
+    switch (state)
+    {
+        case SupervisorState::Unknown:    return "unknown";
+        case SupervisorState::Running:    return "running";
+        case SupervisorState::Ready:      return "ready";
+        case SupervisorState::Restarting: return "restarting";
+        case SupervisorState::Finished:   return "finished";
+    }
+    return "invalid";
+}
+
+StatusPublisher::~StatusPublisher()
+{
+    close();
+}
+
+bool StatusPublisher::open(const string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    // Lock before any change: file may belong to other living supervisor.
+    // Open file description lock is released only when all descriptors of it are closed.
+    struct flock lock = wholeFileLock(F_WRLCK);
+    void *addr = MAP_FAILED;
+    if (::fcntl(fd, F_OFD_SETLK, &lock) == -1)
+    {
+        if (errno == EAGAIN || errno == EACCES)
+            errno = EBUSY;
+    }
+    else if (::ftruncate(fd, sizeof(StatusRecord)) == 0)
+    {
+        addr = ::mmap(nullptr, sizeof(StatusRecord), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    if (addr == MAP_FAILED)
+    {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        return false;
+    }
+
+    m_record = static_cast<StatusRecord*>(addr);
+    m_fd     = fd;
+
+    // File may be left by previous supervisor: keep sequence growing, so readers that already
+    // mapped it never see the same sequence for different content
+    uint32_t seq = m_record->sequence.load(memory_order_relaxed);
+    if (seq & 1)
+        m_record->sequence.store(seq + 1, memory_order_relaxed);
+
+    m_record->version.store(StatusRecord::Version, memory_order_relaxed);
+    m_record->size.store(sizeof(StatusRecord), memory_order_relaxed);
+    m_record->magic.store(StatusRecord::Magic, memory_order_release);
+
+    publish(SupervisorStatus());
+    return true;
+}
+
+void StatusPublisher::close()
+{
+    if (m_record)
+    {
+        ::munmap(m_record, sizeof(StatusRecord));
+        m_record = nullptr;
+    }
+
+    // Plain close(): explicit unlock in the forked child would release supervisor's lock
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool StatusPublisher::isOpen() const
+{
+    return m_record != nullptr;
+}
+
+void StatusPublisher::publish(const SupervisorStatus &status)
+{
+    if (!m_record)
+        return;
+
+    struct timespec now;
+    ::clock_gettime(CLOCK_REALTIME, &now);
+
+    const uint32_t seq = m_record->sequence.load(memory_order_relaxed);
+    m_record->sequence.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    m_record->state.store(uint32_t(status.state), memory_order_relaxed);
+    m_record->supervisorPid.store(status.supervisorPid, memory_order_relaxed);
+    m_record->childPid.store(status.childPid, memory_order_relaxed);
+    m_record->lastExitStatus.store(status.lastExitStatus, memory_order_relaxed);
+    m_record->ready.store(status.ready, memory_order_relaxed);
+    m_record->startTime.store(status.startTime, memory_order_relaxed);
+    m_record->updateTime.store(int64_t(now.tv_sec) * 1000000000 + now.tv_nsec, memory_order_relaxed);
+    m_record->restartCount.store(status.restartCount, memory_order_relaxed);
+
+    m_record->sequence.store(seq + 2, memory_order_release);
+}
+
+StatusReader::~StatusReader()
+{
+    close();
+}
+
+bool StatusReader::open(const string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (::fstat(fd, &st) == 0)
+    {
+        if (S_ISREG(st.st_mode) && size_t(st.st_size) >= sizeof(StatusRecord))
+            addr = ::mmap(nullptr, sizeof(StatusRecord), PROT_READ, MAP_SHARED, fd, 0);
+        else
+            errno = EPROTO;
+    }
+
+    if (addr == MAP_FAILED)
+    {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        return false;
+    }
+
+    m_record = static_cast<const StatusRecord*>(addr);
+    m_fd     = fd;
+
+    // Newer writers only append fields, so larger records are compatible
+    if (m_record->magic.load(memory_order_acquire) != StatusRecord::Magic ||
+        m_record->version.load(memory_order_relaxed) < StatusRecord::Version ||
+        m_record->size.load(memory_order_relaxed) < sizeof(StatusRecord))
+    {
+        close();
+        errno = EPROTO;
+        return false;
+    }
+
+    return true;
+}
+
+void StatusReader::close()
+{
+    if (m_record)
+    {
+        ::munmap(const_cast<StatusRecord*>(m_record), sizeof(StatusRecord));
+        m_record = nullptr;
+    }
+
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool StatusReader::isPublisherAlive() const
+{
+    if (m_fd < 0)
+        return false;
+
+    // Test only: taking the lock even for a moment could make starting publisher fail
+    struct flock lock = wholeFileLock(F_RDLCK);
+    if (::fcntl(m_fd, F_OFD_GETLK, &lock) == -1)
+        return true; // can't tell, do not report living supervisor as dead
+
+    return lock.l_type != F_UNLCK;
+}
+
+bool StatusReader::read(SupervisorStatus &status) const
+{
+    if (!m_record)
+        return false;
+
+    for (int attempt = 0; attempt < ReadAttempts; ++attempt)
+    {
+        const uint32_t before = m_record->sequence.load(memory_order_acquire);
+        if (before & 1)
+            continue;
+
+        status.state          = SupervisorState(m_record->state.load(memory_order_relaxed));
+        status.supervisorPid  = m_record->supervisorPid.load(memory_order_relaxed);
+        status.childPid       = m_record->childPid.load(memory_order_relaxed);
+        status.lastExitStatus = m_record->lastExitStatus.load(memory_order_relaxed);
+        status.ready          = m_record->ready.load(memory_order_relaxed) != 0;
+        status.startTime      = m_record->startTime.load(memory_order_relaxed);
+        status.updateTime     = m_record->updateTime.load(memory_order_relaxed);
+        status.restartCount   = m_record->restartCount.load(memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (m_record->sequence.load(memory_order_relaxed) == before)
+            return true;
+    }
+
+    errno = EAGAIN;
+    return false;
+}
@@ -0,0 +1,166 @@
+#ifndef STATUSTABLE_H
+#define STATUSTABLE_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * Shared-memory supervisor status.
+ *
+ * Every supervisor publishes its state to the small memory-mapped status file (like daemontools'
+ * `supervise/status`). Monitoring agents map status files once and query state with plain memory
+ * reads: no signals, no sockets and no wakeups of the supervisors.
+ *
+ * Record protected by the sequence lock: writer makes sequence odd, updates fields and makes it
+ * even again; reader retries while sequence is odd or changed during the copy. So readers never
+ * block the writer.
+ *
+ * Record layout is versioned: readers must check magic and version, new fields are appended to
+ * the end of record with version increment.
+ *
+ * Publisher holds write lock (open file description lock) on the status file while it is open.
+ * Kernel drops the lock when supervisor dies by any reason, so readers detect stale records left
+ * by crashed or killed supervisors (like daemontools' `supervise/lock`).
+ */
+
+enum class SupervisorState : uint32_t
+{
+    Unknown    = 0,
+    Running    = 1, // child spawned
+    Ready      = 2, // child reported READY=1
+    Restarting = 3, // child exited, restart in progress
+    Finished   = 4, // child exited and will not be restarted
+};
+
+const char *supervisorStateName(SupervisorState state);
+
+/**
+ * @brief The SupervisorStatus struct
+ * Plain snapshot of the status record.
+ */
+struct SupervisorStatus
+{
+    pid_t           supervisorPid  = 0;
+    pid_t           childPid       = 0;
+    SupervisorState state          = SupervisorState::Unknown;
+    bool            ready          = false;
+    int64_t         startTime      = 0;  // current child start, CLOCK_REALTIME nanoseconds
+    int64_t         updateTime     = 0;  // last update, CLOCK_REALTIME nanoseconds
+    uint64_t        restartCount   = 0;
+    int32_t         lastExitStatus = -1; // wait() status of previous child, -1 if none
+};
+
+/**
+ * @brief The StatusRecord struct
+ * Binary layout of the status file. All fields are lock-free atomics, so record can be
+ * accessed from different processes.
+ */
+struct StatusRecord
+{
+    static constexpr uint32_t Magic   = 0x54535653; // "SVST"
+    static constexpr uint16_t Version = 1;
+
+    std::atomic<uint32_t> magic;
+    std::atomic<uint16_t> version;
+    std::atomic<uint16_t> size;
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> state;
+    std::atomic<int32_t>  supervisorPid;
+    std::atomic<int32_t>  childPid;
+    std::atomic<int32_t>  lastExitStatus;
+    std::atomic<uint32_t> ready;
+    std::atomic<int64_t>  startTime;
+    std::atomic<int64_t>  updateTime;
+    std::atomic<uint64_t> restartCount;
+};
+
+static_assert(sizeof(StatusRecord) == 56, "status record layout changed");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "status record requires lock-free atomics to be shared between processes");
+
+/**
+ * @brief The StatusPublisher class
+ * Writer side: owns status file mapping of one supervisor.
+ */
+class StatusPublisher
+{
+public:
+    StatusPublisher() = default;
+    ~StatusPublisher();
+
+    StatusPublisher(const StatusPublisher&) = delete;
+    StatusPublisher& operator=(const StatusPublisher&) = delete;
+
+    /**
+     * @brief open
+     * Create (or reuse) status file, lock and map it.
+     *
+     * @param path  status file name
+     * @return true on success, false on error (errno will be set, EBUSY - file is locked by other
+     *         living publisher)
+     */
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const;
+
+    /**
+     * @brief publish
+     * Update record. Memory writes only, wait-free.
+     */
+    void publish(const SupervisorStatus &status);
+
+private:
+    StatusRecord *m_record = nullptr;
+    int           m_fd     = -1; // keeps the lock
+};
+
+/**
+ * @brief The StatusReader class
+ * Reader side: maps status file read-only once, then read() is a plain memory copy.
+ */
+class StatusReader
+{
+public:
+    StatusReader() = default;
+    ~StatusReader();
+
+    StatusReader(const StatusReader&) = delete;
+    StatusReader& operator=(const StatusReader&) = delete;
+
+    /**
+     * @brief open
+     * Map status file.
+     *
+     * @return true on success, false on error (errno will be set, EPROTO - not a status file or
+     *         unsupported version)
+     */
+    bool open(const std::string &path);
+    void close();
+
+    /**
+     * @brief read
+     * Take consistent snapshot of the record.
+     *
+     * @param status  snapshot
+     * @return false when consistent snapshot can't be taken (writer died in the middle of update)
+     */
+    bool read(SupervisorStatus &status) const;
+
+    /**
+     * @brief isPublisherAlive
+     * Check that supervisor that wrote the record still holds the status file. Lock is tested
+     * only, so publisher is never blocked.
+     *
+     * @return false when record is stale: supervisor crashed, was killed or exited
+     */
+    bool isPublisherAlive() const;
+
+private:
+    const StatusRecord *m_record = nullptr;
+    int                 m_fd     = -1;
+};
+
+#endif // STATUSTABLE_H
@@ -0,0 +1,112 @@
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <algorithm>
+
+#include "tracer.h"
+#include "atomicfile/atomicfile.h"
+
+using namespace std;
+
+namespace {
+
+inline pid_t currentThread()
+{
+    return pid_t(::syscall(SYS_gettid));
+}
+
+}
+
+Tracer::Span::Span(Tracer *tracer, const char *name, const char *category,
+                   const char *argName, int64_t argValue)
+    : m_tracer(tracer),
+      m_name(name),
+      m_category(category),
+      m_argName(argName),
+      m_argValue(argValue),
+      m_begin(tracer ? Tracer::now() : 0)
+{
+}
+
+Tracer::Span::~Span()
+{
+    if (m_tracer)
+        m_tracer->complete(m_name, m_category, m_begin, Tracer::now(), m_argName, m_argValue);
+}
+
+Tracer::Tracer(size_t capacity)
+    : m_events(capacity),
+      m_pid(::getpid())
+{
+}
+
+int64_t Tracer::now()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void Tracer::complete(const char *name, const char *category, int64_t begin, int64_t end,
+                      const char *argName, int64_t argValue, pid_t tid)
+{
+    record({name, category, argName, argValue, begin, end - begin, tid ? tid : currentThread()});
+}
+
+void Tracer::record(const Tracer::Event &event)
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (m_events.empty())
+        return;
+
+    m_events[m_head] = event;
+    m_head = (m_head + 1) % m_events.size();
+    if (m_size < m_events.size())
+        ++m_size;
+}
+
+bool Tracer::dump(const string &path) const
+{
+    return AtomicFile(path).write([this](int fd) { return dump(fd); });
+}
+
+bool Tracer::dump(int fd) const
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    static const char header[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    static const char footer[] = "\n]}\n";
+
+    if (!writeAll(fd, header, sizeof(header) - 1))
+        return false;
+
+    // Oldest event is at the head when buffer wrapped
+    const size_t first = (m_head + m_events.size() - m_size) % (m_events.empty() ? 1 : m_events.size());
+    for (size_t i = 0; i < m_size; ++i)
+    {
+        const Event &ev = m_events[(first + i) % m_events.size()];
+
+        char buf[512];
+        int  len = ::snprintf(buf, sizeof(buf),
+                              "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"pid\":%d,\"tid\":%d,"
+                              "\"ts\":%lld.%03lld,\"ph\":\"X\",\"dur\":%lld.%03lld",
+                              i ? "," : "",
+                              ev.name, ev.category, int(m_pid), int(ev.tid),
+                              (long long)(ev.begin / 1000), (long long)(ev.begin % 1000),
+                              (long long)(ev.duration / 1000), (long long)(ev.duration % 1000));
+
+        if (ev.argName)
+            len += ::snprintf(buf + len, sizeof(buf) - size_t(len),
+                              ",\"args\":{\"%s\":%lld}", ev.argName, (long long)ev.argValue);
+
+        len += ::snprintf(buf + len, sizeof(buf) - size_t(len), "}");
+
+        if (!writeAll(fd, buf, std::min(size_t(len), sizeof(buf) - 1)))
+            return false;
+    }
+
+    return writeAll(fd, footer, sizeof(footer) - 1);
+}
@@ -0,0 +1,120 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * USDT probes: build with SUPERVISE_USDT (needs <sys/sdt.h> from systemtap) to attach `perf` or
+ * bpftrace to the `supervise` provider:
+ * @code
+ * bpftrace -e 'usdt:./supervise:supervise:exit { printf("%d %d\n", arg0, arg1); }'
+ * @endcode
+ * Without it probes compile to nothing.
+ */
+#ifdef SUPERVISE_USDT
+#  include <sys/sdt.h>
+#  define SUPERVISE_PROBE1(name, a1)     DTRACE_PROBE1(supervise, name, a1)
+#  define SUPERVISE_PROBE2(name, a1, a2) DTRACE_PROBE2(supervise, name, a1, a2)
+#else
+#  define SUPERVISE_PROBE1(name, a1)     do {} while (0)
+#  define SUPERVISE_PROBE2(name, a1, a2) do {} while (0)
+#endif
+
+/**
+ * @brief The Tracer class
+ * Records lifecycle spans into the fixed-size in-memory buffer and dumps them in the Chrome
+ * trace-event JSON format (can be opened with Perfetto UI or chrome://tracing).
+ *
+ * Buffer allocated at construction, when it full oldest events are overwritten. Event names,
+ * categories and argument names are not copied, so they must be string literals.
+ *
+ * Recording is thread-safe but not signal-safe: do not record from signal catchers.
+ */
+class Tracer
+{
+public:
+    /**
+     * @brief The Span class
+     * RAII helper: records complete event from construction to destruction. Does nothing when
+     * tracer is null, so it can be left in code unconditionally.
+     */
+    class Span
+    {
+    public:
+        Span(Tracer *tracer, const char *name, const char *category,
+             const char *argName = nullptr, int64_t argValue = 0);
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        Tracer     *m_tracer;
+        const char *m_name;
+        const char *m_category;
+        const char *m_argName;
+        int64_t     m_argValue;
+        int64_t     m_begin;
+    };
+
+    explicit Tracer(size_t capacity = 4096);
+
+    /**
+     * @brief now
+     * @return monotonic time in nanoseconds
+     */
+    static int64_t now();
+
+    /**
+     * @brief complete
+     * Record event that started at `begin` and finished at `end` (see now()).
+     *
+     * Events of one track must nest, so events that overlap with others (like child process
+     * lifetime) should be recorded to the own track `tid`. Zero means current thread.
+     */
+    void complete(const char *name, const char *category, int64_t begin, int64_t end,
+                  const char *argName = nullptr, int64_t argValue = 0, pid_t tid = 0);
+
+    /**
+     * @brief dump
+     * Write recorded events as Chrome trace-event JSON. File replaced atomically (see AtomicFile).
+     *
+     * @param path  trace file name
+     * @return true on success, false on error (errno will be set)
+     */
+    bool dump(const std::string &path) const;
+
+    /**
+     * @brief dump
+     * Write recorded events as Chrome trace-event JSON to the descriptor.
+     */
+    bool dump(int fd) const;
+
+private:
+    struct Event
+    {
+        const char *name;
+        const char *category;
+        const char *argName;
+        int64_t     argValue;
+        int64_t     begin;
+        int64_t     duration;
+        pid_t       tid;
+    };
+
+    void record(const Event &event);
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<Event> m_events;
+    size_t             m_head = 0;
+    size_t             m_size = 0;
+    pid_t              m_pid;
+};
+
+#endif // TRACER_H
@@ -1,45 +1,189 @@
 #include <string.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <spawn.h>
 #include <signal.h>
 #include <sys/prctl.h>
 
-#include <iostream>
+#include <cerrno>
+#include <cstdio>
+#include <atomic>
 #include <memory>
 #include <vector>
 
 #include "lib/processsupervisor/processsupervisor.h"
+#include "lib/tracer/tracer.h"
+#ifndef SUPERVISE_LEAN
 #include "lib/signalmonitor/signalmonitor.h"
+#endif
 
 using namespace std;
 
 namespace {
+#ifndef SUPERVISE_LEAN
 unique_ptr<SignalMonitor> s_sigmonitor;
-pid_t                     s_child;
+#endif
+atomic<pid_t>             s_child(0);
+atomic<int>               s_forwarded(0); // last signal forwarded to the current child
+unique_ptr<Tracer>        s_tracer;
+
+struct Options
+{
+    const char *crashFile    = nullptr;
+    size_t      recorderSize = 256 * 1024;
+    const char *traceFile    = nullptr;
+    bool        notify       = false;
+    long        watchdogMs   = 0;
+    const char *statusFile   = nullptr;
+};
+
+void usage(const char *name)
+{
+    ::fprintf(stderr,
+              "Use: %s [-r crash_file] [-b recorder_bytes] [-t trace_file] [-n] [-w watchdog_ms]\n"
+              "       [-S status_file] prog [args]\n"
+              "  -r crash_file      keep last child output in memory and dump it on crash\n"
+              "  -b recorder_bytes  size of the in-memory output buffer (default: 262144)\n"
+              "  -t trace_file      record lifecycle trace, dump it on exit and on SIGUSR2\n"
+              "  -n                 accept sd_notify() readiness notifications via NOTIFY_SOCKET\n"
+              "  -w watchdog_ms     abort child if it does not send WATCHDOG=1 in time (implies -n)\n"
+              "  -S status_file     publish state to the memory-mapped file (see supervise-status)\n",
+              name);
+    ::exit(1);
+}
 
-void signal_setup()
+int parse_options(int argc, char**argv, Options &opts)
+{
+    int opt;
+    // '+' - stop on first non-option: it is a supervised program
+    while ((opt = ::getopt(argc, argv, "+r:b:t:nw:S:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                opts.crashFile = optarg;
+                break;
+            case 'b':
+                opts.recorderSize = ::strtoul(optarg, nullptr, 0);
+                break;
+            case 't':
+                opts.traceFile = optarg;
+                break;
+            case 'n':
+                opts.notify = true;
+                break;
+            case 'w':
+                opts.notify     = true;
+                opts.watchdogMs = ::strtol(optarg, nullptr, 0);
+                break;
+            case 'S':
+                opts.statusFile = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (optind >= argc)
+        usage(argv[0]);
+
+    return optind;
+}
+
+void print_ready_histogram(const ProcessSupervisor::ReadyHistogram &hist)
+{
+    bool header = false;
+    for (size_t i = 0; i < hist.size(); ++i)
+    {
+        if (!hist[i])
+            continue;
+        if (!header)
+        {
+            ::fprintf(stderr, "time-to-ready histogram (usec):\n");
+            header = true;
+        }
+        ::fprintf(stderr, "  [%llu, %llu): %llu\n",
+                  i ? 1ull << i : 0ull, 2ull << i, (unsigned long long)hist[i]);
+    }
+}
+
+void trace_dump(const Options &opts)
+{
+    if (s_tracer && !s_tracer->dump(opts.traceFile))
+        ::fprintf(stderr, "Can't write trace file %s: %s\n", opts.traceFile, strerror(errno));
+}
+
+#ifndef SUPERVISE_LEAN
+void signal_setup(const Options &opts)
 {
     s_sigmonitor.reset(new SignalMonitor);
-    s_sigmonitor->setHandler([](int signo){
-        if (s_child)
-            kill(s_child, signo);
+    s_sigmonitor->setTracer(s_tracer.get());
+    s_sigmonitor->setHandler([&opts](int signo){
+        if (signo == SIGUSR2)
+        {
+            trace_dump(opts);
+            return;
+        }
+
+        pid_t child = s_child;
+        if (child)
+        {
+            s_forwarded = signo;
+            kill(child, signo);
+        }
     });
     s_sigmonitor->addSignal<SIGTERM>();
     s_sigmonitor->addSignal<SIGINT>();
     s_sigmonitor->addSignal<SIGHUP>();
+    if (s_tracer)
+        s_sigmonitor->addSignal<SIGUSR2>();
+}
+#else
+// Lean profile: kill() is async-signal-safe, so forward signals right from the catcher and
+// do not spend extra thread for the signal monitor. Trace dumped on exit only.
+void signal_forward(int signo)
+{
+    int   err   = errno;
+    pid_t child = s_child;
+    if (child)
+    {
+        s_forwarded = signo;
+        kill(child, signo);
+    }
+    errno = err;
 }
 
-void supervise_process(int argc, char**argv)
+void signal_setup(const Options &)
+{
+    struct sigaction sa = {};
+    sa.sa_handler = signal_forward;
+    sa.sa_flags   = SA_RESTART;
+    ::sigemptyset(&sa.sa_mask);
+
+    for (int signo : {SIGTERM, SIGINT, SIGHUP})
+        ::sigaction(signo, &sa, nullptr);
+}
+#endif
+
+void supervise_process(int argc, char**argv, const Options &opts)
 {
     ProcessSupervisor mon;
 
     vector<char*> args(argc + 1, nullptr);
-    for (size_t i = 1; i < size_t(argc); ++i)
+    for (size_t i = 0; i < size_t(argc); ++i)
     {
-        args[i - 1] = ::strdup(argv[i]);
+        args[i] = ::strdup(argv[i]);
     }
 
-    mon.setForkRoutine([&args](){
+    if (opts.crashFile)
+        mon.setFlightRecorder(opts.crashFile, opts.recorderSize);
+    mon.setTracer(s_tracer.get());
+    mon.setNotifyEnabled(opts.notify);
+    mon.setWatchdogTimeout(int64_t(opts.watchdogMs) * 1000);
+    if (opts.statusFile)
+        mon.setStatusFile(opts.statusFile);
+
+    mon.setOutputForkRoutine([&args](int out, int err){
         pid_t pid;
 
 #if __linux__
@@ -53,37 +197,59 @@ void supervise_process(int argc, char**argv)
                 ::signal(sig, SIG_DFL);
             }
 
+            // Flight recorder pipes or own stdout and stderr
+            ::dup2(out, STDOUT_FILENO);
+            ::dup2(err, STDERR_FILENO);
+
             // Unexpected parent exit
             ::prctl(PR_SET_PDEATHSIG, SIGKILL, 0, 0, 0);
             if (::execvp(args[0], args.data()) < 0)
             {
-                cerr << "Can't exec process: errno=" << errno << ", text=" << strerror(errno) << endl;
+                ::fprintf(stderr, "Can't exec process: errno=%d, text=%s\n", errno, strerror(errno));
                 ::exit(255);
             }
         }
 #else
-        if(posix_spawnp(&pid, args[0], nullptr, nullptr, args.data(), nullptr) < 0)
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, err, STDERR_FILENO);
+        if(posix_spawnp(&pid, args[0], &actions, nullptr, args.data(), nullptr) != 0)
         {
             pid = -1;
         }
+        posix_spawn_file_actions_destroy(&actions);
 #endif
 
         if (pid < 0)
         {
-            cerr << "Can't spawn process: errno=" << errno << ", text=" << strerror(errno) << endl;
+            ::fprintf(stderr, "Can't spawn process: errno=%d, text=%s\n", errno, strerror(errno));
             ::exit(1);
         }
 
-        s_child = pid;
+        s_forwarded = 0;
+        s_child     = pid;
 
         return pid;
     });
 
     mon.setLogCallback([](const std::string& text){
-        cerr << text << endl;
+        ::fprintf(stderr, "%s\n", text.c_str());
     });
 
-    mon.setRestartCheckCallback([](int status){
+    mon.setCrashCheckCallback([&mon](int status){
+        // Child stopped on request is not a crash: keep report of the real one
+        const int forwarded = s_forwarded;
+        if (forwarded == SIGINT || forwarded == SIGTERM)
+            return false;
+        if (mon.watchdogFired())
+            return true;
+        if (WIFSIGNALED(status))
+            return WTERMSIG(status) != forwarded;
+        return WIFEXITED(status) && WEXITSTATUS(status) != 0;
+    });
+
+    mon.setRestartCheckCallback([&mon](int status){
         bool signaled = WIFSIGNALED(status);
         int  signal   = WTERMSIG(status);
         bool exited   = WIFEXITED(status);
@@ -96,6 +262,13 @@ void supervise_process(int argc, char**argv)
             return true;
         }
 
+        // Hung child may handle SIGABRT and exit cleanly
+        if (mon.watchdogFired())
+        {
+            ::sleep(2);
+            return true;
+        }
+
         if (exited)
         {
             if (exitstat)
@@ -113,6 +286,10 @@ void supervise_process(int argc, char**argv)
     for (auto & arg : args)
         free(arg);
 
+    trace_dump(opts);
+    if (opts.notify)
+        print_ready_histogram(mon.readyHistogram());
+
     ::exit(sts);
 }
 
@@ -121,14 +298,14 @@ void supervise_process(int argc, char**argv)
 
 int main(int argc, char**argv)
 {
-    if (argc < 2)
-    {
-        cerr << "Use: " << argv[0] << " prog [args]\n";
-        ::exit(1);
-    }
+    Options opts;
+    int     first = parse_options(argc, argv, opts);
+
+    if (opts.traceFile)
+        s_tracer.reset(new Tracer);
 
-    signal_setup();
-    supervise_process(argc, argv);
+    signal_setup(opts);
+    supervise_process(argc - first, argv + first, opts);
 
     return 0;
 }
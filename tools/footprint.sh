@@ -0,0 +1,70 @@
+#!/usr/bin/env bash
+#
+# Compare resident memory and startup-to-first-spawn time of two supervise builds.
+#
+# Use: tools/footprint.sh [default_binary] [lean_binary]
+#
+# Default binaries are build/supervise and build-lean/supervise (cmake -DSUPERVISE_LEAN=ON).
+# Startup time measured from the supervise exec to the moment when supervised bash prints
+# $EPOCHREALTIME, so it includes bash startup: compare numbers, not absolute values.
+#
+# RSS includes text pages of the binary that are shared between all supervisors on a host, so
+# per-instance cost is a dirty private memory (Private_Dirty from smaps_rollup).
+# Exits with non-zero status when lean build dirty private memory exceeds MAX_PRIVATE_KB (default: 256).
+#
+
+set -e
+
+DEFAULT_BIN=${1:-build/supervise}
+LEAN_BIN=${2:-build-lean/supervise}
+RUNS=${RUNS:-50}
+MAX_PRIVATE_KB=${MAX_PRIVATE_KB:-256}
+
+# prints: rss_kb private_kb
+memory_kb()
+{
+    local bin=$1
+    "$bin" sleep 2 2>/dev/null &
+    local pid=$!
+    sleep 0.5
+    awk '/^Rss:/ { rss = $2 } /^Private_Dirty:/ { priv = $2 } END { print rss, priv }' \
+        "/proc/$pid/smaps_rollup"
+    kill -TERM "$pid"
+    wait "$pid" 2>/dev/null || true
+}
+
+startup_us()
+{
+    local bin=$1
+    local samples=()
+    for ((i = 0; i < RUNS; ++i)); do
+        local t0 t1
+        t0=$EPOCHREALTIME
+        t1=$("$bin" bash --norc --noprofile -c 'echo $EPOCHREALTIME' 2>/dev/null)
+        samples+=($(awk -v a="$t0" -v b="$t1" 'BEGIN { printf "%d", (b - a) * 1000000 }'))
+    done
+    # median
+    printf '%s\n' "${samples[@]}" | sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }'
+}
+
+printf '%-8s %-32s %10s %10s %12s\n' "build" "binary" "rss_kb" "dirty_kb" "startup_us"
+for build in default lean; do
+    if [ "$build" = default ]; then bin=$DEFAULT_BIN; else bin=$LEAN_BIN; fi
+    if [ ! -x "$bin" ]; then
+        echo "$bin: not found" >&2
+        exit 1
+    fi
+    # Freshly linked binary pages are dirty in the page cache and counted as Private_Dirty
+    sync
+    read -r rss priv < <(memory_kb "$bin")
+    start=$(startup_us "$bin")
+    printf '%-8s %-32s %10s %10s %12s\n' "$build" "$bin" "$rss" "$priv" "$start"
+    if [ "$build" = lean ]; then
+        lean_private=$priv
+    fi
+done
+
+if [ "$lean_private" -gt "$MAX_PRIVATE_KB" ]; then
+    echo "lean build dirty private memory ${lean_private} KiB exceeds ${MAX_PRIVATE_KB} KiB" >&2
+    exit 1
+fi
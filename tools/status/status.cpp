@@ -0,0 +1,124 @@
+/*
+ * supervise-status: print state of supervisors from their status files.
+ *
+ * Status files are read with plain memory reads (see StatusReader), supervisors are not disturbed.
+ * Directory arguments are scanned: every status file in it is printed, other files are skipped.
+ * Records of supervisors that died without finishing (crashed, killed) are reported as `dead`.
+ */
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "statustable/statustable.h"
+
+using namespace std;
+
+namespace {
+
+void printHeader()
+{
+    ::printf("%-32s %8s %8s %-10s %5s %10s %8s %-12s\n",
+             "FILE", "SUPER", "CHILD", "STATE", "READY", "UPTIME", "RESTARTS", "LAST_EXIT");
+}
+
+void formatExit(int status, char *buf, size_t size)
+{
+    if (status < 0)
+        ::snprintf(buf, size, "-");
+    else if (WIFSIGNALED(status))
+        ::snprintf(buf, size, "signal %d", WTERMSIG(status));
+    else
+        ::snprintf(buf, size, "exit %d", WEXITSTATUS(status));
+}
+
+void printStatus(const string &path, const SupervisorStatus &st, bool alive)
+{
+    struct timespec now;
+    ::clock_gettime(CLOCK_REALTIME, &now);
+    const int64_t nowNs = int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+
+    // Stale record: its child pid and state mean nothing
+    const bool dead = !alive && st.state != SupervisorState::Finished;
+
+    char uptime[32] = "-";
+    if (!dead && st.childPid && st.startTime)
+        ::snprintf(uptime, sizeof(uptime), "%.1fs", double(nowNs - st.startTime) / 1e9);
+
+    char lastExit[32];
+    formatExit(st.lastExitStatus, lastExit, sizeof(lastExit));
+
+    ::printf("%-32s %8d %8d %-10s %5s %10s %8llu %-12s\n",
+             path.c_str(), int(st.supervisorPid), int(st.childPid),
+             dead ? "dead" : supervisorStateName(st.state), !dead && st.ready ? "yes" : "no", uptime,
+             (unsigned long long)st.restartCount, lastExit);
+}
+
+/**
+ * @return true when status printed
+ */
+bool showFile(const string &path, bool quiet)
+{
+    StatusReader     reader;
+    SupervisorStatus st;
+    if (!reader.open(path) || !reader.read(st))
+    {
+        if (!quiet)
+            ::fprintf(stderr, "%s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    printStatus(path, st, reader.isPublisherAlive());
+    return true;
+}
+
+bool showDirectory(const string &path)
+{
+    DIR *dir = ::opendir(path.c_str());
+    if (!dir)
+    {
+        ::fprintf(stderr, "%s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    while (struct dirent *ent = ::readdir(dir))
+    {
+        if (ent->d_name[0] == '.')
+            continue;
+        showFile(path + "/" + ent->d_name, true);
+    }
+    ::closedir(dir);
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        ::fprintf(stderr, "Use: %s status_file|directory...\n", argv[0]);
+        return 2;
+    }
+
+    printHeader();
+
+    bool ok = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        struct stat st;
+        if (::stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode))
+            ok = showDirectory(argv[i]) && ok;
+        else
+            ok = showFile(argv[i], false) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,685 @@
+/*
+ * Churn/soak stress harness for the ProcessSupervisor reap and restart paths.
+ *
+ * Many supervisors are served from one epoll loop via non-blocking API. Synthetic children crash,
+ * exit with random codes, ignore signals, wait for a signal and spawn grandchildren while another
+ * thread fires signals at the harness that SignalMonitor forwards to the children.
+ *
+ * Checked invariants:
+ * - exit status reported by supervisor matches child behaviour
+ * - child restarted exactly when restart check allows (prerestart called, new child spawned)
+ * - every signal sent to the harness reaches SignalMonitor handler (paced mode), or every
+ *   message accepted by the monitor pipe is handled (burst mode: signals coalesce, pipe overflows)
+ * - forwarded SIGUSR1 kills the child it was sent to: child killed by SIGUSR1 that was not
+ *   forwarded to it and waiting child that survived forwarded signal are failures
+ * - no zombies and no leftover children after all supervisors finished
+ * - bounded descriptor and RSS growth after warm-up
+ *
+ * Reports restarts per second and respawn latency (from exit observed to new child spawned).
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "processsupervisor/processsupervisor.h"
+#include "signalmonitor/signalmonitor.h"
+#include "tracer/tracer.h"
+
+using namespace std;
+
+namespace {
+
+enum ChildMode
+{
+    ModeCrash,      // SIGSEGV after short work
+    ModeExitCode,   // exit with random code
+    ModeIgnore,     // ignore forwarded signals, exit normally
+    ModeGrandchild, // spawn short-living grandchild and exit
+    ModeWait,       // wait for forwarded signal, exit with WaitTimeoutStatus if it does not come
+    ModeCount
+};
+
+// Waiting child gives up after timeout: it is a lost signal when SIGUSR1 was forwarded to it
+constexpr long WaitTimeoutUsec   = 500000;
+constexpr int  WaitTimeoutStatus = 99;
+
+struct Options
+{
+    int         duration    = 10;    // seconds
+    size_t      supervisors = 8;
+    long        signalUsec  = 1000;  // interval between signals
+    long        burst       = 0;     // signals per interval without waiting, 0 - paced firing
+    unsigned    seed        = 0;
+    const char *crashDir    = nullptr;
+    long        maxFdGrowth = 0;
+    long        maxRssGrowthKb = 1024;
+};
+
+struct Instance
+{
+    ProcessSupervisor sv;
+    size_t   index     = 0;
+    int      mode      = ModeCrash;
+    int      param     = 0;
+    pid_t    pid       = 0;     // current child
+    int64_t  exitSeen  = 0;     // exit observed by restart check
+    uint64_t spawns    = 0;
+    uint64_t restarts  = 0;     // restart check allows restart
+    uint64_t prerestarts = 0;
+    uint64_t stops     = 0;     // restart check denies restart
+    uint64_t mismatches = 0;    // exit status does not match child mode
+    uint64_t delivered = 0;     // forwarded SIGUSR1 killed the child
+    uint64_t ignored   = 0;     // forwarded SIGUSR1 ignored by the child as expected
+    uint64_t raced     = 0;     // child exited on its own before forwarded SIGUSR1 arrived
+    uint64_t lost      = 0;     // waiting child survived forwarded SIGUSR1
+    uint64_t misdelivered = 0;  // child killed by SIGUSR1 that was not forwarded to it
+};
+
+// Respawn latency histogram with 1 usec resolution, allocated before warm-up
+constexpr size_t LatencyBuckets = 100000;
+
+vector<uint32_t>                 s_latency;
+int64_t                          s_latencyMax = 0;
+uint64_t                         s_latencyCount = 0;
+
+unique_ptr<SignalMonitor>        s_sigmonitor;
+unique_ptr<atomic<pid_t>[]>      s_children;
+unique_ptr<atomic<pid_t>[]>      s_forwarded;   // child of the slot that SIGUSR1 forwarded to
+size_t                           s_childrenCount = 0;
+atomic<uint64_t>                 s_signalsReceived(0);
+atomic<uint64_t>                 s_signalsForwarded(0);
+
+int64_t monotonicUsec()
+{
+    return Tracer::now() / 1000;
+}
+
+void sleepUsec(long usec)
+{
+    struct timespec ts = {usec / 1000000, (usec % 1000000) * 1000};
+    while (::nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        ;
+}
+
+void usage(const char *name)
+{
+    ::fprintf(stderr,
+              "Use: %s [-d seconds] [-n supervisors] [-s signal_usec] [-b burst] [-r seed]\n"
+              "        [-c crash_dir] [-f max_fd_growth] [-m max_rss_growth_kb]\n"
+              "  -d seconds           test duration (default: 10)\n"
+              "  -n supervisors       count of supervisors (default: 8)\n"
+              "  -s signal_usec       interval between signals sent to harness, 0 - disable (default: 1000)\n"
+              "  -b burst             fire `burst` signals and monitor messages per interval without\n"
+              "                       waiting for handling (default: 0 - one signal, wait for it)\n"
+              "  -r seed              random seed (default: time based)\n"
+              "  -c crash_dir         enable flight recorder, crash files written to the directory\n"
+              "  -f max_fd_growth     allowed descriptor count growth after warm-up (default: 0)\n"
+              "  -m max_rss_growth_kb allowed RSS growth after warm-up (default: 1024)\n",
+              name);
+    ::exit(2);
+}
+
+void parseOptions(int argc, char **argv, Options &opts)
+{
+    opts.seed = unsigned(::time(nullptr));
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "d:n:s:b:r:c:f:m:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd': opts.duration       = ::atoi(optarg); break;
+            case 'n': opts.supervisors    = ::strtoul(optarg, nullptr, 0); break;
+            case 's': opts.signalUsec     = ::strtol(optarg, nullptr, 0); break;
+            case 'b': opts.burst          = ::strtol(optarg, nullptr, 0); break;
+            case 'r': opts.seed           = unsigned(::strtoul(optarg, nullptr, 0)); break;
+            case 'c': opts.crashDir       = optarg; break;
+            case 'f': opts.maxFdGrowth    = ::strtol(optarg, nullptr, 0); break;
+            case 'm': opts.maxRssGrowthKb = ::strtol(optarg, nullptr, 0); break;
+            default:  usage(argv[0]);
+        }
+    }
+
+    if (opts.supervisors == 0 || opts.duration <= 0 || opts.burst < 0)
+        usage(argv[0]);
+}
+
+long countFds()
+{
+    long count = 0;
+    DIR *dir = ::opendir("/proc/self/fd");
+    if (!dir)
+        return -1;
+    while (struct dirent *ent = ::readdir(dir))
+    {
+        if (ent->d_name[0] != '.')
+            ++count;
+    }
+    ::closedir(dir);
+    return count - 1; // opendir() descriptor
+}
+
+long rssKb()
+{
+    FILE *fp = ::fopen("/proc/self/status", "re");
+    if (!fp)
+        return -1;
+
+    char line[256];
+    long rss = -1;
+    while (::fgets(line, sizeof(line), fp))
+    {
+        if (::sscanf(line, "VmRSS: %ld", &rss) == 1)
+            break;
+    }
+    ::fclose(fp);
+    return rss;
+}
+
+/**
+ * Scan /proc for own children: returns count of zombies and living children.
+ */
+void scanChildren(long &zombies, long &alive)
+{
+    zombies = 0;
+    alive   = 0;
+
+    const pid_t self = ::getpid();
+    DIR *dir = ::opendir("/proc");
+    if (!dir)
+        return;
+
+    while (struct dirent *ent = ::readdir(dir))
+    {
+        if (ent->d_name[0] < '0' || ent->d_name[0] > '9')
+            continue;
+
+        char path[300];
+        ::snprintf(path, sizeof(path), "/proc/%s/stat", ent->d_name);
+        FILE *fp = ::fopen(path, "re");
+        if (!fp)
+            continue;
+
+        // comm may contain spaces: parse after last ')'
+        char buf[512];
+        size_t len = ::fread(buf, 1, sizeof(buf) - 1, fp);
+        ::fclose(fp);
+        buf[len] = '\0';
+
+        const char *p = ::strrchr(buf, ')');
+        char state;
+        int  ppid;
+        if (!p || ::sscanf(p + 1, " %c %d", &state, &ppid) != 2 || ppid != self)
+            continue;
+
+        if (state == 'Z')
+            ++zombies;
+        else
+            ++alive;
+    }
+    ::closedir(dir);
+}
+
+/**
+ * Child body. Called after fork() in the multi-threaded process: async-signal-safe calls only.
+ */
+[[noreturn]] void runChild(int mode, int param)
+{
+    for (int sig : {SIGTERM, SIGINT, SIGHUP, SIGUSR1})
+        ::signal(sig, mode == ModeIgnore ? SIG_IGN : SIG_DFL);
+
+    sigset_t all;
+    ::sigfillset(&all);
+    ::sigprocmask(SIG_UNBLOCK, &all, nullptr);
+
+    switch (mode)
+    {
+        case ModeCrash:
+            sleepUsec(param);
+            ::signal(SIGSEGV, SIG_DFL);
+            ::raise(SIGSEGV);
+            break;
+
+        case ModeExitCode:
+            ::_exit(param);
+
+        case ModeIgnore:
+            sleepUsec(param);
+            ::_exit(0);
+
+        case ModeGrandchild:
+            if (::fork() == 0)
+            {
+                sleepUsec(param);
+                ::_exit(0);
+            }
+            ::_exit(7);
+
+        case ModeWait:
+            sleepUsec(WaitTimeoutUsec);
+            ::_exit(WaitTimeoutStatus);
+    }
+    ::_exit(255);
+}
+
+/**
+ * Exit status expected for the child mode. Forwarded SIGUSR1 kills any child except ignoring ones.
+ */
+bool statusMatches(int mode, int param, int status)
+{
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGUSR1)
+        return mode != ModeIgnore;
+
+    switch (mode)
+    {
+        case ModeCrash:      return WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV;
+        case ModeExitCode:   return WIFEXITED(status) && WEXITSTATUS(status) == param;
+        case ModeIgnore:     return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        case ModeGrandchild: return WIFEXITED(status) && WEXITSTATUS(status) == 7;
+        case ModeWait:       return WIFEXITED(status) && WEXITSTATUS(status) == WaitTimeoutStatus;
+    }
+    return false;
+}
+
+/**
+ * Match forwarded SIGUSR1 against child exit
+ */
+void checkForwarded(Instance &inst, int status)
+{
+    const bool forwarded = s_forwarded[inst.index] == inst.pid;
+    const bool killed    = WIFSIGNALED(status) && WTERMSIG(status) == SIGUSR1;
+    s_forwarded[inst.index] = 0;
+
+    if (killed && !forwarded)
+    {
+        ++inst.misdelivered;
+        ::fprintf(stderr, "supervisor %zu: child %d killed by SIGUSR1 that was not forwarded to it\n",
+                  inst.index, int(inst.pid));
+    }
+    else if (killed)
+    {
+        ++inst.delivered;
+    }
+    else if (forwarded && inst.mode == ModeIgnore)
+    {
+        ++inst.ignored;
+    }
+    else if (forwarded && inst.mode == ModeWait)
+    {
+        ++inst.lost;
+        ::fprintf(stderr, "supervisor %zu: waiting child %d survived forwarded SIGUSR1\n",
+                  inst.index, int(inst.pid));
+    }
+    else if (forwarded)
+    {
+        ++inst.raced;
+    }
+}
+
+void recordLatency(int64_t usec)
+{
+    ++s_latencyCount;
+    s_latencyMax = std::max(s_latencyMax, usec);
+    ++s_latency[size_t(std::min<int64_t>(std::max<int64_t>(usec, 0), LatencyBuckets - 1))];
+}
+
+int64_t latencyPercentile(double pct)
+{
+    const uint64_t target = uint64_t(double(s_latencyCount) * pct / 100.0);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < s_latency.size(); ++i)
+    {
+        sum += s_latency[i];
+        if (sum > target)
+            return int64_t(i);
+    }
+    return s_latencyMax;
+}
+
+void setupInstance(Instance &inst, mt19937 &rng, const int64_t &deadline, const Options &opts)
+{
+    // Nobody kills waiting child without signals
+    const int modes = opts.signalUsec > 0 ? ModeCount : ModeWait;
+
+    inst.sv.setForkRoutine([&inst, &rng, modes]() {
+        inst.mode  = int(rng() % unsigned(modes));
+        inst.param = inst.mode == ModeExitCode ? int(rng() % 256) : int(rng() % 2000);
+
+        // Block signals while forking: inherited catchers must not write to the monitor pipe
+        sigset_t all, old;
+        ::sigfillset(&all);
+        ::pthread_sigmask(SIG_BLOCK, &all, &old);
+
+        pid_t pid = ::fork();
+        if (pid == 0)
+            runChild(inst.mode, inst.param);
+
+        ::pthread_sigmask(SIG_SETMASK, &old, nullptr);
+        return pid;
+    });
+
+    inst.sv.setPostforkCallback([&inst](int pid) {
+        ++inst.spawns;
+        inst.pid = pid;
+        s_children[inst.index] = pid;
+        if (inst.exitSeen)
+        {
+            recordLatency(monotonicUsec() - inst.exitSeen);
+            inst.exitSeen = 0;
+        }
+    });
+
+    inst.sv.setRestartCheckCallback([&inst, &deadline](int status) {
+        s_children[inst.index] = 0;
+        checkForwarded(inst, status);
+
+        if (!statusMatches(inst.mode, inst.param, status))
+        {
+            ++inst.mismatches;
+            ::fprintf(stderr, "supervisor %zu: status %d does not match mode %d (param %d)\n",
+                      inst.index, status, inst.mode, inst.param);
+        }
+
+        const int64_t now = monotonicUsec();
+        if (now >= deadline)
+        {
+            ++inst.stops;
+            return false;
+        }
+
+        ++inst.restarts;
+        inst.exitSeen = now;
+        return true;
+    });
+
+    inst.sv.setPrerestartCallback([&inst]() {
+        ++inst.prerestarts;
+    });
+
+
+    if (opts.crashDir)
+        inst.sv.setFlightRecorder(string(opts.crashDir) + "/crash." + to_string(inst.index), 4096);
+}
+
+void signalSetup()
+{
+    s_sigmonitor.reset(new SignalMonitor);
+    s_sigmonitor->setHandler([](int signo) {
+        if (signo != SIGUSR1)
+            return;
+
+        const uint64_t n    = s_signalsReceived.fetch_add(1) + 1;
+        const size_t   slot = n % s_childrenCount;
+        pid_t child = s_children[slot];
+        if (!child)
+            return;
+
+        // Exited child can't be killed: it is an exit that raced with forwarding, skip it
+        siginfo_t info = {};
+        if (::waitid(P_PID, id_t(child), &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid != 0)
+            return;
+
+        // Recorded before kill(): restart check may run right after the child dies
+        s_forwarded[slot] = child;
+        if (::kill(child, SIGUSR1) == 0)
+            ++s_signalsForwarded;
+    });
+    s_sigmonitor->addSignal<SIGUSR1>();
+}
+
+/**
+ * Fires signals at the harness. Next signal sent only when previous one handled, otherwise
+ * standard signals coalesce. Signal not handled in 1 second counted as lost.
+ */
+void signalFiring(const Options &opts, const int64_t &deadline, uint64_t &sent, uint64_t &lost)
+{
+    while (monotonicUsec() < deadline)
+    {
+        const uint64_t expected = s_signalsReceived + 1;
+        ::kill(::getpid(), SIGUSR1);
+        ++sent;
+
+        const int64_t timeout = monotonicUsec() + 1000000;
+        while (s_signalsReceived < expected && monotonicUsec() < timeout)
+            sleepUsec(50);
+        if (s_signalsReceived < expected)
+            ++lost;
+
+        sleepUsec(opts.signalUsec);
+    }
+}
+
+/**
+ * Fires bursts without waiting for handling: signals sent to the harness coalesce in the kernel,
+ * messages sent to the monitor directly (like many catcher calls) overflow the pipe. Every
+ * message accepted by the pipe must be handled, so handled count must be in
+ * [accepted, accepted + signals]. Handling not finished in 1 second after the last burst counted
+ * as lost.
+ */
+void signalBurst(const Options &opts, const int64_t &deadline, uint64_t &sent, uint64_t &accepted,
+                 uint64_t &dropped, uint64_t &lost)
+{
+    while (monotonicUsec() < deadline)
+    {
+        for (long i = 0; i < opts.burst; ++i)
+        {
+            if (s_sigmonitor->sendMessage(SIGUSR1) == 1)
+                ++accepted;
+            else
+                ++dropped; // pipe full: catcher drops signal the same way
+        }
+
+        for (long i = 0; i < opts.burst; ++i)
+        {
+            ::kill(::getpid(), SIGUSR1);
+            ++sent;
+        }
+
+        sleepUsec(opts.signalUsec);
+    }
+
+    // Wait for the handler to drain the pipe: it is quiet for 100 ms
+    const int64_t timeout = monotonicUsec() + 1000000;
+    uint64_t      handled = s_signalsReceived;
+    int64_t       quiet   = monotonicUsec() + 100000;
+    while (monotonicUsec() < timeout && (handled < accepted || monotonicUsec() < quiet))
+    {
+        sleepUsec(1000);
+        if (s_signalsReceived != handled)
+        {
+            handled = s_signalsReceived;
+            quiet   = monotonicUsec() + 100000;
+        }
+    }
+
+    // Handled count out of range: messages lost or handled twice
+    if (handled < accepted)
+        lost = accepted - handled;
+    else if (handled > accepted + sent)
+        lost = handled - accepted - sent;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    Options opts;
+    parseOptions(argc, argv, opts);
+
+    mt19937 rng(opts.seed);
+
+    s_latency.assign(LatencyBuckets, 0);
+    s_childrenCount = opts.supervisors;
+    s_children.reset(new atomic<pid_t>[opts.supervisors]);
+    s_forwarded.reset(new atomic<pid_t>[opts.supervisors]);
+    for (size_t i = 0; i < opts.supervisors; ++i)
+    {
+        s_children[i]  = 0;
+        s_forwarded[i] = 0;
+    }
+
+    signalSetup();
+
+    const int64_t start    = monotonicUsec();
+    const int64_t deadline = start + int64_t(opts.duration) * 1000000;
+    const int64_t warmup   = start + std::min<int64_t>(1000000, int64_t(opts.duration) * 1000000 / 4);
+
+    int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+    {
+        ::perror("epoll_create1");
+        return 2;
+    }
+
+    vector<unique_ptr<Instance>> instances;
+    for (size_t i = 0; i < opts.supervisors; ++i)
+    {
+        instances.emplace_back(new Instance);
+        Instance &inst = *instances.back();
+        inst.index = i;
+        setupInstance(inst, rng, deadline, opts);
+
+        inst.sv.launch();
+
+        struct epoll_event ev = {};
+        ev.events   = EPOLLIN;
+        ev.data.ptr = &inst;
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, inst.sv.pollFd(), &ev);
+    }
+
+    uint64_t signalsSent     = 0;
+    uint64_t signalsLost     = 0;
+    uint64_t messagesAccepted = 0;
+    uint64_t messagesDropped  = 0;
+    thread   firing;
+    if (opts.signalUsec > 0 && opts.burst > 0)
+        firing = thread(signalBurst, std::cref(opts), std::cref(deadline), std::ref(signalsSent),
+                        std::ref(messagesAccepted), std::ref(messagesDropped), std::ref(signalsLost));
+    else if (opts.signalUsec > 0)
+        firing = thread(signalFiring, std::cref(opts), std::cref(deadline),
+                        std::ref(signalsSent), std::ref(signalsLost));
+
+    long   warmFds = -1;
+    long   warmRss = -1;
+    size_t active  = instances.size();
+    while (active)
+    {
+        struct epoll_event events[64];
+        int ready = ::epoll_wait(epfd, events, 64, 100);
+        if (ready < 0 && errno != EINTR)
+        {
+            ::perror("epoll_wait");
+            return 2;
+        }
+
+        for (int i = 0; i < ready; ++i)
+        {
+            Instance &inst = *static_cast<Instance*>(events[i].data.ptr);
+            inst.sv.processEvents();
+            if (inst.sv.finished())
+            {
+                ::epoll_ctl(epfd, EPOLL_CTL_DEL, inst.sv.pollFd(), nullptr);
+                --active;
+            }
+        }
+
+        if (warmFds < 0 && monotonicUsec() >= warmup)
+        {
+            warmFds = countFds();
+            warmRss = rssKb();
+        }
+    }
+
+    const int64_t elapsed = monotonicUsec() - start;
+
+    if (firing.joinable())
+        firing.join();
+
+    const long endFds = countFds();
+    const long endRss = rssKb();
+
+    // Grandchildren are reparented to init, so only own children are checked
+    long zombies, alive;
+    scanChildren(zombies, alive);
+
+    uint64_t spawns = 0, restarts = 0, prerestarts = 0, stops = 0, mismatches = 0;
+    uint64_t delivered = 0, ignored = 0, raced = 0, forwardLost = 0, misdelivered = 0;
+    uint64_t decisionErrors = 0;
+    for (auto &inst : instances)
+    {
+        spawns       += inst->spawns;
+        restarts     += inst->restarts;
+        prerestarts  += inst->prerestarts;
+        stops        += inst->stops;
+        mismatches   += inst->mismatches;
+        delivered    += inst->delivered;
+        ignored      += inst->ignored;
+        raced        += inst->raced;
+        forwardLost  += inst->lost;
+        misdelivered += inst->misdelivered;
+
+        // Every allowed restart spawns new child, denied restart finishes supervisor
+        if (inst->spawns != inst->restarts + 1 || inst->prerestarts != inst->restarts ||
+            inst->stops != 1 || !inst->sv.finished())
+        {
+            ++decisionErrors;
+            ::fprintf(stderr, "supervisor %zu: spawns=%llu restarts=%llu prerestarts=%llu stops=%llu\n",
+                      inst->index, (unsigned long long)inst->spawns,
+                      (unsigned long long)inst->restarts, (unsigned long long)inst->prerestarts,
+                      (unsigned long long)inst->stops);
+        }
+    }
+
+    const bool fdOk  = endFds - warmFds <= opts.maxFdGrowth;
+    const bool rssOk = endRss - warmRss <= opts.maxRssGrowthKb;
+    const bool ok    = mismatches == 0 && decisionErrors == 0 && signalsLost == 0 &&
+                       forwardLost == 0 && misdelivered == 0 &&
+                       zombies == 0 && alive == 0 && fdOk && rssOk;
+
+    ::printf("seed:               %u\n", opts.seed);
+    ::printf("duration:           %.3f s\n", double(elapsed) / 1e6);
+    ::printf("supervisors:        %zu\n", instances.size());
+    ::printf("spawns:             %llu\n", (unsigned long long)spawns);
+    ::printf("restarts:           %llu (%.1f/s)\n", (unsigned long long)restarts,
+             double(restarts) * 1e6 / double(elapsed));
+    ::printf("respawn latency:    p50=%lld us, p99=%lld us, p99.9=%lld us, max=%lld us\n",
+             (long long)latencyPercentile(50), (long long)latencyPercentile(99),
+             (long long)latencyPercentile(99.9), (long long)s_latencyMax);
+    ::printf("status mismatches:  %llu\n", (unsigned long long)mismatches);
+    ::printf("decision errors:    %llu\n", (unsigned long long)decisionErrors);
+    ::printf("signals:            sent=%llu, handled=%llu, lost=%llu\n",
+             (unsigned long long)signalsSent, (unsigned long long)s_signalsReceived.load(),
+             (unsigned long long)signalsLost);
+    if (opts.burst > 0)
+        ::printf("monitor messages:   accepted=%llu, dropped (pipe full)=%llu\n",
+                 (unsigned long long)messagesAccepted, (unsigned long long)messagesDropped);
+    ::printf("forwarded:          %llu (delivered=%llu, ignored=%llu, raced=%llu, lost=%llu, misdelivered=%llu)\n",
+             (unsigned long long)s_signalsForwarded.load(), (unsigned long long)delivered,
+             (unsigned long long)ignored, (unsigned long long)raced,
+             (unsigned long long)forwardLost, (unsigned long long)misdelivered);
+    ::printf("children left:      zombies=%ld, alive=%ld\n", zombies, alive);
+    ::printf("descriptors:        warm=%ld, end=%ld%s\n", warmFds, endFds, fdOk ? "" : " (GROWTH)");
+    ::printf("rss:                warm=%ld KiB, end=%ld KiB%s\n", warmRss, endRss, rssOk ? "" : " (GROWTH)");
+    ::printf("result:             %s\n", ok ? "OK" : "FAILED");
+
+    ::close(epfd);
+    return ok ? 0 : 1;
+}